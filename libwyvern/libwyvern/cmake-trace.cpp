@@ -0,0 +1,282 @@
+#include <libwyvern/cmake-trace.hpp>
+
+#include <algorithm>
+#include <cctype>
+
+#include <libwyvern/trace.hpp>
+
+namespace wyvern::detail {
+namespace {
+
+  // Configurations of the packages' files to trace, as `install(EXPORT)` names them (lowercase).
+  constexpr const char* traced_configurations[] = { "noconfig", "none", "release", "debug", "relwithdebinfo", "minsizerel" };
+
+  // Commands changing what the targets of the directory use, whichever target they link to.
+  constexpr const char* directory_commands[] = {
+    "add_compile_definitions", "add_compile_options", "add_definitions", "add_link_options", "include_directories",
+    "link_directories", "link_libraries", "remove_definitions", "set_directory_properties",
+  };
+
+  // Variables of CMake the packages' files can set without changing how the generated targets are built.
+  constexpr const char* harmless_variables[] = { "CMAKE_IMPORT_FILE_VERSION", "CMAKE_MODULE_PATH", "CMAKE_PREFIX_PATH" };
+
+  auto to_lower(std::string text) -> std::string
+  {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+    return text;
+  }
+
+  auto contains(const std::vector<std::string>& values, std::string_view value) -> bool
+  {
+    return std::find(values.begin(), values.end(), value) != values.end();
+  }
+
+  // Like `set_property(APPEND)`: empty values are not appended.
+  auto append_to_list(std::string& list, const std::string& value) -> void
+  {
+    if(value.empty())
+      return;
+    if(!list.empty())
+      list += ';';
+    list += value;
+  }
+
+  auto join_values(std::vector<std::string>::const_iterator begin, std::vector<std::string>::const_iterator end) -> std::string
+  {
+    return fmt::format("{}", fmt::join(begin, end, ";"));
+  }
+
+}
+
+  auto trace_arguments(const std::vector<std::string>& package_names, const std::string& build_type) -> std::vector<std::string>
+  {
+    auto configurations = std::set<std::string>(std::begin(traced_configurations), std::end(traced_configurations));
+    if(!build_type.empty())
+      configurations.insert(to_lower(build_type));
+
+    std::set<std::string> file_names;
+    for(const auto& package_name : package_names)
+    {
+      for(const auto& name : { package_name, to_lower(package_name) })
+      {
+        for(const auto& stem : { name + "Config", name + "-config", name + "Targets", name + "-targets" })
+        {
+          file_names.insert(stem + ".cmake");
+          for(const auto& configuration : configurations)
+            file_names.insert(format("{}-{}.cmake", stem, configuration));
+        }
+        for(const auto& version_stem : { name + "ConfigVersion", name + "Config-version", name + "-config-version", name + "-configVersion" })
+          file_names.insert(version_stem + ".cmake");
+      }
+    }
+
+    std::vector<std::string> args{ "--trace-expand", "--trace-format=json-v1" };
+    for(const auto& file_name : file_names)
+      args.push_back("--trace-source=" + file_name);
+    return args;
+  }
+
+  auto TraceReader::read_line(std::string_view line) -> bool
+  {
+    // Each line of the trace is a JSON object, the keys sorted: `{"version":...}` first, then `{"args":...}` for each command.
+    const auto is_version = line.substr(0, 11) == R"({"version":)";
+    if(!is_version && (!has_version || line.substr(0, 8) != R"({"args":)"))
+      return false;
+
+    const auto entry = json::parse(line.begin(), line.end(), nullptr, false);
+    if(!entry.is_object())
+      return false;
+    if(is_version)
+    {
+      const auto& version = entry["version"];
+      if(!version.is_object() || version.value("major", 0) != 1)
+        return false;
+      has_version = true;
+      bytes += line.size();
+      return true;
+    }
+
+    const auto args = entry.find("args");
+    const auto cmd = entry.find("cmd");
+    const auto file = entry.find("file");
+    if(args == entry.end() || cmd == entry.end() || file == entry.end() || !args->is_array() || !cmd->is_string() || !file->is_string())
+      return false;
+
+    ++commands;
+    bytes += line.size();
+    const auto file_path = path(file->get<std::string>()).normalize().string();
+    traced_files.insert(file_path);
+    read_command(to_lower(cmd->get<std::string>()), args->get<std::vector<std::string>>(), file_path);
+    return true;
+  }
+
+  auto TraceReader::target(const std::string& name, const std::string& command) -> ImportedTarget*
+  {
+    const auto found = targets.find(name);
+    if(found != targets.end())
+      return &found->second;
+    reasons.insert(format("{}() on {}, which is not an imported target of the traced files", command, name));
+    return nullptr;
+  }
+
+  // The arguments are the ones CMake evaluated (`--trace-expand`), the commands of the branches it did not take are not traced.
+  auto TraceReader::read_command(const std::string& name, const std::vector<std::string>& args, const std::string& file) -> void
+  {
+    if(name == "add_library" || name == "add_executable")
+    {
+      if(args.empty())
+        return; // CMake fails.
+      if(name == "add_library" && args.size() == 3 && args[1] == "ALIAS")
+      {
+        const auto aliased = aliases.find(args[2]);
+        aliases[args[0]] = aliased == aliases.end() ? args[2] : aliased->second;
+        return;
+      }
+      if(!contains(args, "IMPORTED"))
+      {
+        reasons.insert(format("{}({}) in {} of a target which is not imported", name, args[0], file));
+        return;
+      }
+      targets[args[0]].type = name == "add_library" && args.size() > 1 ? args[1] : std::string{ "EXECUTABLE" };
+    }
+    else if(name == "set_target_properties")
+    {
+      const auto properties = std::find(args.begin(), args.end(), "PROPERTIES");
+      if(properties == args.end() || (args.end() - properties - 1) % 2 != 0)
+        return; // CMake fails.
+      for(auto target_name = args.begin(); target_name != properties; ++target_name)
+      {
+        if(auto imported_target = target(*target_name, name))
+        {
+          for(auto property = properties + 1; property != args.end(); property += 2)
+            imported_target->properties[*property] = *(property + 1);
+        }
+      }
+    }
+    else if(name == "set_property")
+    {
+      if(args.empty() || args[0] != "TARGET")
+      {
+        if(args.empty() || args[0] != "GLOBAL")
+          reasons.insert(format("set_property({}) in {}", args.empty() ? std::string{} : args[0], file));
+        return;
+      }
+      const auto property = std::find(args.begin(), args.end(), "PROPERTY");
+      if(property == args.end() || property + 1 == args.end())
+        return; // CMake fails.
+
+      bool is_append = false;
+      std::vector<ImportedTarget*> property_targets;
+      for(auto value = args.begin() + 1; value != property; ++value)
+      {
+        if(*value == "APPEND")
+          is_append = true;
+        else if(*value == "APPEND_STRING")
+          reasons.insert(format("set_property(APPEND_STRING) in {}", file));
+        else if(auto imported_target = target(*value, name))
+          property_targets.push_back(imported_target);
+      }
+
+      const auto& property_name = *(property + 1);
+      const auto value = join_values(property + 2, args.end());
+      for(auto imported_target : property_targets)
+      {
+        auto& property_value = imported_target->properties[property_name];
+        if(!is_append)
+          property_value.clear();
+        append_to_list(property_value, value);
+      }
+    }
+    else if(name == "target_link_libraries" || name == "target_include_directories" || name == "target_compile_definitions")
+    {
+      if(args.size() < 2)
+        return;
+      if(args[1] != "INTERFACE")
+      {
+        reasons.insert(format("{}({} {}) in {}", name, args[0], args[1], file));
+        return;
+      }
+      auto imported_target = target(args[0], name);
+      if(!imported_target)
+        return;
+
+      const auto property_name = name == "target_link_libraries" ? "INTERFACE_LINK_LIBRARIES"
+                               : name == "target_include_directories" ? "INTERFACE_INCLUDE_DIRECTORIES"
+                               : "INTERFACE_COMPILE_DEFINITIONS";
+      auto& property_value = imported_target->properties[property_name];
+      for(auto value = args.begin() + 2; value != args.end(); ++value)
+      {
+        if(*value == "INTERFACE" || *value == "PUBLIC" || *value == "PRIVATE" || *value == "SYSTEM" || *value == "BEFORE" || *value == "AFTER"
+           || *value == "debug" || *value == "optimized" || *value == "general")
+        {
+          reasons.insert(format("{}({} ... {}) in {}", name, args[0], *value, file));
+          return;
+        }
+        // Like CMake, which removes the flag of the definitions.
+        append_to_list(property_value, name == "target_compile_definitions" && value->substr(0, 2) == "-D" ? value->substr(2) : *value);
+      }
+    }
+    else if(name.substr(0, 7) == "target_"
+            || std::find(std::begin(directory_commands), std::end(directory_commands), name) != std::end(directory_commands))
+    {
+      reasons.insert(format("{}() in {}", name, file));
+    }
+    else if(name == "set" || name == "unset" || (name == "list" && args.size() > 1)
+            || (name == "string" && args.size() > 1 && (args[0] == "APPEND" || args[0] == "PREPEND")))
+    {
+      // The variables of CMake used to build the generated targets, like CMAKE_CXX_FLAGS, must not change.
+      const auto& variable = name == "set" || name == "unset" ? (args.empty() ? std::string{} : args[0]) : args[1];
+      if(variable.substr(0, 6) == "CMAKE_"
+         && std::find(std::begin(harmless_variables), std::end(harmless_variables), variable) == std::end(harmless_variables))
+        reasons.insert(format("{}({}) in {}", name, variable, file));
+    }
+  }
+
+  auto TraceReader::check_files(const std::vector<path>& external_files) const -> void
+  {
+    if(!has_version)
+      throw unsupported("CMake wrote no trace");
+    if(!reasons.empty())
+      throw unsupported(format("{}", fmt::join(reasons, ", ")));
+
+    std::vector<std::string> untraced_files;
+    for(const auto& file_path : external_files)
+    {
+      const auto file = path(file_path).normalize().string();
+      if(traced_files.count(file) == 0)
+        untraced_files.push_back(file);
+    }
+    if(!untraced_files.empty())
+      throw unsupported(format("the commands of {} were not traced", fmt::join(untraced_files, ", ")));
+  }
+
+  auto TraceReader::usage_requirements(const std::string& target_name, const Platform& platform, const std::string& configuration) const -> Target
+  {
+    const auto resolved = [&](const std::string& name) -> const std::string& {
+      const auto found = aliases.find(name);
+      return found == aliases.end() ? name : found->second;
+    };
+    if(aliases.empty())
+      return detail::usage_requirements(targets, platform, target_name, configuration);
+
+    // CMake links to the targets named by the aliases.
+    auto aliased_targets = targets;
+    for(auto& [name, imported_target] : aliased_targets)
+    {
+      const auto libraries = imported_target.properties.find("INTERFACE_LINK_LIBRARIES");
+      if(libraries == imported_target.properties.end())
+        continue;
+      std::string resolved_libraries;
+      std::string_view rest = libraries->second;
+      while(!rest.empty())
+      {
+        const auto separator = rest.find(';');
+        append_to_list(resolved_libraries, resolved(std::string{ rest.substr(0, separator) }));
+        rest = separator == std::string_view::npos ? std::string_view{} : rest.substr(separator + 1);
+      }
+      libraries->second = std::move(resolved_libraries);
+    }
+    return detail::usage_requirements(aliased_targets, platform, resolved(target_name), configuration);
+  }
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <map>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <libwyvern/wyvern.hpp>
+#include <libwyvern/utility.hpp>
+#include <libwyvern/export-files.hpp>
+#include <libwyvern/export.hpp>
+
+namespace wyvern::detail {
+
+  // Extraction from a trace of the commands CMake runs in the packages' files while configuring the project with
+  // the dependencies (see `Backend::trace`): the imported targets they define are reconstructed from the commands,
+  // with the arguments CMake evaluated, as the export files reader would (see export-files.hpp).
+  // What the trace can't tell exactly throws `unsupported`.
+
+  // The first version of CMake writing the trace as JSON (`--trace-format=json-v1`).
+  inline constexpr auto json_trace_minimum_cmake_version = "3.17";
+
+  // Arguments tracing the files of the packages. `--trace-source` only takes whole file names: those which
+  // `find_package()` and `install(EXPORT)` give to the files of a package are traced, for the usual configurations
+  // and `build_type`. Files with other names are not, `TraceReader::check_files()` then tells.
+  LIBWYVERN_SYMEXPORT
+  auto trace_arguments(const std::vector<std::string>& package_names, const std::string& build_type) -> std::vector<std::string>;
+
+  // Reads the trace as CMake writes it, one line at a time: only the targets are kept, not the trace.
+  class LIBWYVERN_SYMEXPORT TraceReader
+  {
+    std::map<std::string, ImportedTarget> targets;
+    std::map<std::string, std::string> aliases; // To the name of the target.
+    std::set<std::string> traced_files;
+    std::set<std::string> reasons; // What the trace can't tell exactly.
+    bool has_version = false;
+    std::size_t commands = 0;
+    std::size_t bytes = 0;
+
+    auto read_command(const std::string& name, const std::vector<std::string>& args, const std::string& file) -> void;
+    auto target(const std::string& name, const std::string& command) -> ImportedTarget*;
+
+  public:
+    // Returns false if the line is not part of the trace: CMake writes it with the other messages.
+    auto read_line(std::string_view line) -> bool;
+
+    // Throws `unsupported` if a command of the trace can't be reconstructed, or if the trace misses
+    // some of `external_files`, the files outside of CMake that CMake read (see `read_cmake_files_reply()`).
+    auto check_files(const std::vector<path>& external_files) const -> void;
+
+    // Like `ExportFilesReader::usage_requirements()`, with the targets the trace defined.
+    auto usage_requirements(const std::string& target_name, const Platform& platform, const std::string& configuration) const -> Target;
+
+    auto commands_read() const -> std::size_t { return commands; }
+    auto bytes_read() const -> std::size_t { return bytes; }
+  };
+
+}
@@ -0,0 +1,120 @@
+#include <libwyvern/context.hpp>
+
+namespace wyvern::detail {
+namespace {
+
+  // How often a thread waiting to run a process checks whether the call must stop.
+  constexpr auto process_wait_interval = std::chrono::milliseconds{ 50 };
+
+}
+
+  CallContext::CallContext(const Options& options)
+    : engine([]{
+        std::random_device device;
+        std::seed_seq seed{ device(), device(), device(), device() };
+        return std::default_random_engine{ seed };
+      }())
+    , trace_file(options.trace_file)
+    , is_logging_enabled(options.enable_logging)
+    , log_level(options.log_level)
+    , log_sink(options.log_sink ? std::make_shared<const LogSink>(options.log_sink) : nullptr)
+    , tracer(options.trace_file.empty() ? nullptr : std::make_unique<Tracer>())
+    , cancellation(options.cancellation)
+    , timeouts(options.timeouts)
+    , deadline(options.timeouts.total.count() > 0
+        ? std::make_optional(std::chrono::steady_clock::now() + options.timeouts.total)
+        : std::nullopt)
+    , cmake_output_tail_size(options.cmake_output_tail_size)
+    , cmake_output_handler(options.cmake_output_handler)
+    , max_processes(options.max_jobs)
+  {
+  }
+
+  CallContext::~CallContext()
+  {
+    if(tracer)
+    {
+      const ScopedContext scoped_context{ this }; // To log with the call's settings.
+      // The trace is only a diagnostic: failing to write it must not fail (or hide the failure of) the call.
+      try
+      {
+        write_to_file(trace_file, tracer->to_json().dump());
+      }
+      catch(const std::exception& error)
+      {
+        log(LogLevel::warning, "failed to write the trace to {}: {}", trace_file.string(), error.what());
+      }
+    }
+
+    if(is_logging_enabled)
+      flush_log();
+  }
+
+  auto CallContext::random_int(int min_value, int max_value) -> int
+  {
+    const std::lock_guard<std::mutex> lock{ engine_mutex };
+    std::uniform_int_distribution<int> distribution(min_value, max_value);
+    return distribution(engine);
+  }
+
+  auto CallContext::check_interruption() const -> void
+  {
+    if(cancellation.is_cancelled())
+      throw ExtractionCancelled("extraction cancelled");
+
+    if(deadline && std::chrono::steady_clock::now() >= *deadline)
+      throw ExtractionTimeout(format("extraction did not finish in {} ms", timeouts.total.count()));
+  }
+
+  auto CallContext::acquire_process() -> void
+  {
+    if(max_processes == 0)
+      return;
+
+    std::unique_lock<std::mutex> lock{ processes_mutex };
+    while(running_processes >= max_processes)
+    {
+      process_finished.wait_for(lock, process_wait_interval);
+      check_interruption();
+    }
+    ++running_processes;
+  }
+
+  auto CallContext::release_process() -> void
+  {
+    if(max_processes == 0)
+      return;
+
+    {
+      const std::lock_guard<std::mutex> lock{ processes_mutex };
+      --running_processes;
+    }
+    process_finished.notify_one();
+  }
+
+  ProcessPermit::ProcessPermit()
+    : context(current_context())
+  {
+    if(context)
+      context->acquire_process();
+  }
+
+  ProcessPermit::~ProcessPermit()
+  {
+    if(context)
+      context->release_process();
+  }
+
+  auto check_interruption() -> void
+  {
+    if(const auto context = current_context())
+      context->check_interruption();
+  }
+
+  auto current_timeouts() -> Timeouts
+  {
+    const auto context = current_context();
+    return context ? context->timeouts : Timeouts{};
+  }
+
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <optional>
+#include <condition_variable>
+
+#include <libwyvern/wyvern.hpp>
+#include <libwyvern/utility.hpp>
+#include <libwyvern/trace.hpp>
+#include <libwyvern/export.hpp>
+
+namespace wyvern::detail {
+
+  // State of one call to the library (`extract_dependencies()`, `extract_dependencies_batch()`):
+  // its logging settings, its trace, its random numbers and when to stop it, so that concurrent calls don't interfere.
+  // The threads working for the call share it (see `ScopedContext`), what can change is synchronized.
+  class LIBWYVERN_SYMEXPORT CallContext
+  {
+    std::mutex engine_mutex;
+    std::default_random_engine engine;
+    path trace_file;
+    std::mutex processes_mutex;
+    std::condition_variable process_finished;
+    unsigned running_processes = 0;
+
+  public:
+    const bool is_logging_enabled;
+    const LogLevel log_level;
+    const std::shared_ptr<const LogSink> log_sink; // The process-wide sink if null.
+    const std::unique_ptr<Tracer> tracer; // Null if not tracing.
+    const CancellationToken cancellation;
+    const Timeouts timeouts;
+    const std::optional<std::chrono::steady_clock::time_point> deadline; // Of the whole call.
+    const std::size_t cmake_output_tail_size;
+    const std::function<void(std::string_view line)> cmake_output_handler;
+    const unsigned max_processes; // CMake processes run at once by all the threads of the call, no limit if 0 (see `Options::max_jobs`).
+
+    explicit CallContext(const Options& options);
+    ~CallContext(); // Writes the trace, then waits for the call's messages to be delivered.
+    CallContext(const CallContext&) = delete;
+    CallContext& operator=(const CallContext&) = delete;
+
+    auto random_int(int min_value, int max_value) -> int;
+
+    // Throws `ExtractionCancelled` or `ExtractionTimeout` if the call must stop.
+    auto check_interruption() const -> void;
+
+    // Waits until the call runs less than `max_processes` CMake processes, then counts one more until released.
+    // Waiting stops if the call must stop.
+    auto acquire_process() -> void;
+    auto release_process() -> void;
+  };
+
+  // Counts a CMake process of the current call, if any, from construction to destruction (see `CallContext::acquire_process()`).
+  class LIBWYVERN_SYMEXPORT ProcessPermit
+  {
+    CallContext* context;
+
+  public:
+    ProcessPermit();
+    ~ProcessPermit();
+    ProcessPermit(const ProcessPermit&) = delete;
+    ProcessPermit& operator=(const ProcessPermit&) = delete;
+  };
+
+  // Same, for the current call if any.
+  LIBWYVERN_SYMEXPORT
+  auto check_interruption() -> void;
+
+  // Maximum durations of the phases of the current call, no limit outside of calls.
+  LIBWYVERN_SYMEXPORT
+  auto current_timeouts() -> Timeouts;
+
+}
@@ -0,0 +1,138 @@
+#include <libwyvern/diff.hpp>
+
+#include <libwyvern/utility.hpp>
+#include <libwyvern/trace.hpp>
+
+#include <string_view>
+#include <memory>
+#include <unordered_map>
+
+namespace wyvern::detail {
+namespace {
+
+  // `Key` is how values are looked up, to avoid copying strings.
+  template<class Key, class Values, class Allocator>
+  auto ordered_difference(const Values& left, const Values& right, const Allocator& allocator)
+    -> Values
+  {
+    if(right.empty())
+      return Values(left, allocator);
+
+    // Number of occurrences of each value of `right` still to be removed from `left`.
+    using Counts = std::unordered_map<Key, std::size_t, std::hash<Key>, std::equal_to<Key>,
+                                      typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<const Key, std::size_t>>>;
+    Counts to_remove(allocator);
+    to_remove.reserve(right.size());
+    for(const auto& value : right)
+      ++to_remove[value];
+
+    Values diff(allocator);
+    diff.reserve(left.size());
+    for(const auto& value : left)
+    {
+      const auto found = to_remove.find(value);
+      if(found != to_remove.end() && found->second > 0)
+        --found->second;
+      else
+        diff.push_back(value);
+    }
+    return diff;
+  }
+
+}
+
+  auto difference(const std::vector<std::string>& left, const std::vector<std::string>& right)
+    -> std::vector<std::string>
+  {
+    return ordered_difference<std::string_view>(left, right, left.get_allocator());
+  }
+
+  auto difference(const Symbols& left, const Symbols& right) -> Symbols
+  {
+    return ordered_difference<Symbol>(left, right, left.get_allocator());
+  }
+
+namespace {
+
+  auto differences(const InternedCompilation& left, const InternedCompilation& right, ExtractionSession& session) -> InternedCompilation
+  {
+    InternedCompilation different{ session.memory() };
+    different.compilation_flags = difference(left.compilation_flags, right.compilation_flags);
+    different.defines = difference(left.defines, right.defines);
+    different.include_directories = difference(left.include_directories, right.include_directories);
+    different.source_files = difference(left.source_files, right.source_files);
+    return different;
+  }
+
+  auto differences(const InternedTarget& left, const InternedTarget& right, ExtractionSession& session) -> InternedTarget
+  {
+    InternedTarget different{ session.memory() };
+    different.libraries_directories = difference(left.libraries_directories, right.libraries_directories);
+    different.link_flags = difference(left.link_flags, right.link_flags);
+    different.link_libraries = difference(left.link_libraries, right.link_libraries);
+
+    for(const auto& [ language_name, left_compilation ] : left.language_compilation)
+    {
+      const auto right_compilation = right.language_compilation.find(language_name);
+      if(right_compilation == right.language_compilation.end()) // Nothing to remove for a language only used on the left.
+        different.language_compilation[language_name] = left_compilation;
+      else
+        different.language_compilation[language_name] = differences(left_compilation, right_compilation->second, session);
+    }
+
+    return different;
+  }
+
+  auto differences(const InternedConfiguration& dependent, const InternedTarget& control, ExtractionSession& session) -> InternedConfiguration
+  {
+    InternedConfiguration different{ session.memory() };
+    const std::string_view prefix = target_prefix;
+    for(const auto& [target_name, dependent_target] : dependent.targets)
+    {
+      // Deduce the dependency name by removing the prefix of our test target.
+      std::string_view dependency_name = target_name;
+      if(dependency_name.substr(0, prefix.size()) == prefix)
+        dependency_name.remove_prefix(prefix.size());
+      different.targets[std::pmr::string{ dependency_name, session.memory() }] = differences(dependent_target, control, session);
+    }
+    return different;
+  }
+
+}
+
+  auto extract_dependencies(const cmake::CodeModel& codemodel, const SymbolTable& symbols) -> DependenciesInfo
+  {
+    DependenciesInfo dependencies;
+    for(const auto& [config_name, config] : codemodel.configs)
+      dependencies.configurations[config_name] = to_configuration(config, symbols);
+    return dependencies;
+  }
+
+  auto compare_dependencies(const DependenciesInfo& control, const cmake::CodeModel& dependent_codemodel, ExtractionSession& session)
+    -> DependenciesInfo
+  {
+    TraceSpan span{ "compare_dependencies" };
+    DependenciesInfo diff;
+
+    const auto control_target_name = format("{}{}", target_prefix, control_target);
+    for(const auto& [config_name, config] : dependent_codemodel.configs)
+    {
+      const auto control_config_target = [&]() -> InternedTarget {
+        const auto control_config = control.configurations.find(config_name);
+        if(control_config == control.configurations.end())
+          return InternedTarget{ session.memory() };
+        const auto found_target = control_config->second.targets.find(control_target_name);
+        if(found_target == control_config->second.targets.end())
+          return InternedTarget{ session.memory() };
+        return intern(found_target->second, session.symbols);
+      }();
+      // Only the results leave the session's memory.
+      diff.configurations[config_name] = to_configuration(differences(config, control_config_target, session), session.symbols);
+      span.arg("targets", config.targets.size());
+    }
+    span.arg("configurations", dependent_codemodel.configs.size());
+
+    return diff;
+  }
+
+}
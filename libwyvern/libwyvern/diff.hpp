@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <libwyvern/wyvern.hpp>
+#include <libwyvern/symbols.hpp>
+#include <libwyvern/session.hpp>
+#include <libwyvern/file-api.hpp>
+#include <libwyvern/export.hpp>
+
+namespace wyvern::detail {
+
+  // Values of `left` which are not in `right`, in the order of `left`.
+  // Repeated values are handled as in a multiset: each value of `right` removes one occurrence
+  // (the first one) of the same value in `left`. Linear in the size of both inputs.
+  LIBWYVERN_SYMEXPORT
+  auto difference(const std::vector<std::string>& left, const std::vector<std::string>& right)
+    -> std::vector<std::string>;
+
+  // Same, for interned values. The result and the temporary state are allocated from `left`'s memory resource.
+  LIBWYVERN_SYMEXPORT
+  auto difference(const Symbols& left, const Symbols& right) -> Symbols;
+
+  // Dependencies of each target of the codemodel, as is.
+  LIBWYVERN_SYMEXPORT
+  auto extract_dependencies(const cmake::CodeModel& codemodel, const SymbolTable& symbols) -> DependenciesInfo;
+
+  // What each target of the dependent project uses that the control target (of the same configuration)
+  // doesn't, by dependency name. Both projects' values must be interned in the session's symbols.
+  LIBWYVERN_SYMEXPORT
+  auto compare_dependencies(const DependenciesInfo& control, const cmake::CodeModel& dependent_codemodel, ExtractionSession& session)
+    -> DependenciesInfo;
+
+}
@@ -0,0 +1,1652 @@
+#include <libwyvern/export-files.hpp>
+
+#include <cctype>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <regex>
+#include <set>
+#include <string_view>
+
+#include <libbutl/filesystem.mxx>
+
+#include <libwyvern/trace.hpp>
+
+namespace wyvern::detail {
+namespace {
+
+  constexpr auto npos = std::string_view::npos;
+
+  auto to_upper(std::string text) -> std::string
+  {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c){ return static_cast<char>(std::toupper(c)); });
+    return text;
+  }
+
+  auto to_lower(std::string text) -> std::string
+  {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
+    return text;
+  }
+
+  auto starts_with(std::string_view text, std::string_view prefix) -> bool
+  {
+    return text.substr(0, prefix.size()) == prefix;
+  }
+
+  auto ends_with(std::string_view text, std::string_view suffix) -> bool
+  {
+    return text.size() >= suffix.size() && text.substr(text.size() - suffix.size()) == suffix;
+  }
+
+  // Elements of a CMake list, without the empty ones.
+  auto split_list(std::string_view list) -> std::vector<std::string>
+  {
+    std::vector<std::string> elements;
+    while(!list.empty())
+    {
+      const auto separator = list.find(';');
+      const auto element = list.substr(0, separator);
+      if(!element.empty())
+        elements.emplace_back(element);
+      if(separator == npos)
+        break;
+      list.remove_prefix(separator + 1);
+    }
+    return elements;
+  }
+
+  auto join_list(const std::vector<std::string>& elements) -> std::string
+  {
+    return fmt::format("{}", fmt::join(elements, ";"));
+  }
+
+  auto parse_number(const std::string& text) -> std::optional<double>
+  {
+    if(text.empty())
+      return {};
+    char* end = nullptr;
+    const auto number = std::strtod(text.c_str(), &end);
+    if(*end != '\0')
+      return {};
+    return number;
+  }
+
+  // `cmIsOff()`: false values of variables.
+  auto is_off(const std::string& value) -> bool
+  {
+    const auto upper = to_upper(value);
+    return upper.empty() || upper == "0" || upper == "OFF" || upper == "NO" || upper == "FALSE" || upper == "N"
+        || upper == "IGNORE" || upper == "NOTFOUND" || ends_with(upper, "-NOTFOUND");
+  }
+
+  // Directory part of a path, like `get_filename_component(... PATH)`.
+  auto directory_part(const std::string& file_path) -> std::string
+  {
+    const auto separator = file_path.rfind('/');
+    if(separator == npos)
+      return {};
+    return separator == 0 ? "/" : file_path.substr(0, separator);
+  }
+
+  auto normalized(const std::string& file_path) -> std::string
+  {
+    return path(file_path).normalize().string();
+  }
+
+  struct Argument
+  {
+    enum class Kind { unquoted, quoted, bracket };
+
+    Kind kind;
+    std::string text; // As written, evaluated when the command runs.
+  };
+
+  struct Command
+  {
+    std::string name; // Lowercase: command names are case-insensitive.
+    std::vector<Argument> arguments;
+    std::size_t line;
+  };
+
+  // A parsed file. Blocks are matched once: `next_clause` gives, for an if/elseif/else,
+  // its next elseif/else/endif and, for the other blocks (foreach, macro...), their end.
+  struct Script
+  {
+    path file_path;
+    std::vector<Command> commands;
+    std::vector<std::size_t> next_clause;
+  };
+
+  // The CMake language grammar (see cmake-language(7)), without the legacy forms.
+  class Parser
+  {
+    const path& file_path;
+    std::string_view text;
+    std::size_t index = 0;
+    std::size_t line = 1;
+
+    [[noreturn]] auto error(std::string_view what) const -> void
+    {
+      throw unsupported(format("{}:{}: {}", file_path.string(), line, what));
+    }
+
+    auto peek(std::size_t offset = 0) const -> char
+    {
+      return index + offset < text.size() ? text[index + offset] : '\0';
+    }
+
+    auto at_end() const -> bool { return index >= text.size(); }
+
+    auto advance() -> char
+    {
+      const auto c = text[index++];
+      if(c == '\n')
+        ++line;
+      return c;
+    }
+
+    // Number of `=` of the bracket opening at the current position (`[==[`), npos if there is none.
+    auto bracket_level() const -> std::size_t
+    {
+      if(peek() != '[')
+        return npos;
+      std::size_t level = 0;
+      while(peek(1 + level) == '=')
+        ++level;
+      return peek(1 + level) == '[' ? level : npos;
+    }
+
+    auto read_bracket(std::size_t level) -> std::string
+    {
+      index += level + 2;
+      if(peek() == '\r' && peek(1) == '\n')
+        index += 1;
+      if(peek() == '\n')
+        advance();
+
+      const auto closing = "]" + std::string(level, '=') + "]";
+      const auto end = text.find(closing, index);
+      if(end == npos)
+        error("unterminated bracket");
+
+      std::string content{ text.substr(index, end - index) };
+      line += std::count(content.begin(), content.end(), '\n');
+      index = end + closing.size();
+      return content;
+    }
+
+    auto skip_spaces_and_comments() -> void
+    {
+      while(!at_end())
+      {
+        const auto c = peek();
+        if(c == ' ' || c == '\t' || c == '\r' || c == '\n')
+        {
+          advance();
+        }
+        else if(c == '#')
+        {
+          ++index;
+          const auto level = bracket_level();
+          if(level != npos)
+            read_bracket(level);
+          else
+            while(!at_end() && peek() != '\n')
+              ++index;
+        }
+        else
+        {
+          return;
+        }
+      }
+    }
+
+    // Escape sequences are kept, they are evaluated with the variable references.
+    auto read_quoted() -> std::string
+    {
+      advance();
+      std::string content;
+      while(true)
+      {
+        if(at_end())
+          error("unterminated quoted argument");
+        const auto c = advance();
+        if(c == '"')
+          return content;
+        content += c;
+        if(c == '\\')
+        {
+          if(at_end())
+            error("unterminated quoted argument");
+          content += advance();
+        }
+      }
+    }
+
+    auto read_unquoted() -> std::string
+    {
+      std::string content;
+      while(!at_end())
+      {
+        const auto c = peek();
+        if(c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '(' || c == ')' || c == '#')
+          break;
+        if(c == '"')
+          error("quotes in an unquoted argument");
+        content += advance();
+        if(c == '\\')
+        {
+          if(at_end())
+            error("unterminated escape sequence");
+          content += advance();
+        }
+      }
+      return content;
+    }
+
+    auto read_command() -> Command
+    {
+      Command command;
+      command.line = line;
+      if(!std::isalpha(static_cast<unsigned char>(peek())) && peek() != '_')
+        error("expected a command");
+      while(std::isalnum(static_cast<unsigned char>(peek())) || peek() == '_')
+        command.name += static_cast<char>(std::tolower(static_cast<unsigned char>(advance())));
+
+      while(peek() == ' ' || peek() == '\t')
+        ++index;
+      if(peek() != '(')
+        error(format("expected '(' after {}", command.name));
+      ++index;
+
+      // Nested parentheses are arguments of their own (see `if()`).
+      std::size_t depth = 0;
+      while(true)
+      {
+        skip_spaces_and_comments();
+        if(at_end())
+          error(format("unterminated {}()", command.name));
+
+        const auto c = peek();
+        const auto level = bracket_level();
+        if(c == ')')
+        {
+          ++index;
+          if(depth == 0)
+            return command;
+          --depth;
+          command.arguments.push_back({ Argument::Kind::unquoted, ")" });
+        }
+        else if(c == '(')
+        {
+          ++index;
+          ++depth;
+          command.arguments.push_back({ Argument::Kind::unquoted, "(" });
+        }
+        else if(c == '"')
+          command.arguments.push_back({ Argument::Kind::quoted, read_quoted() });
+        else if(level != npos)
+          command.arguments.push_back({ Argument::Kind::bracket, read_bracket(level) });
+        else
+          command.arguments.push_back({ Argument::Kind::unquoted, read_unquoted() });
+      }
+    }
+
+  public:
+    Parser(const path& file_path, std::string_view text)
+      : file_path(file_path), text(text)
+    {}
+
+    auto parse() -> std::vector<Command>
+    {
+      std::vector<Command> commands;
+      while(true)
+      {
+        skip_spaces_and_comments();
+        if(at_end())
+          return commands;
+        commands.push_back(read_command());
+      }
+    }
+  };
+
+  auto parse_script(const path& file_path) -> Script
+  {
+    const MappedFile file{ file_path };
+    Script script{ file_path, Parser{ file_path, file.content() }.parse(), {} };
+
+    script.next_clause.assign(script.commands.size(), npos);
+    std::vector<std::size_t> open_blocks; // Last clause of each block.
+    for(std::size_t index = 0; index < script.commands.size(); ++index)
+    {
+      const auto& name = script.commands[index].name;
+      const auto mismatched = [&]{
+        throw unsupported(format("{}:{}: unexpected {}()", file_path.string(), script.commands[index].line, name));
+      };
+      const auto open_name = [&]() -> std::string {
+        return open_blocks.empty() ? std::string{} : script.commands[open_blocks.back()].name;
+      };
+
+      if(name == "if" || name == "foreach" || name == "while" || name == "macro" || name == "function")
+      {
+        open_blocks.push_back(index);
+      }
+      else if(name == "elseif" || name == "else" || name == "endif")
+      {
+        const auto open = open_name();
+        if(open != "if" && open != "elseif" && open != "else")
+          mismatched();
+        script.next_clause[open_blocks.back()] = index;
+        open_blocks.pop_back();
+        if(name != "endif")
+          open_blocks.push_back(index);
+      }
+      else if(name == "endforeach" || name == "endwhile" || name == "endmacro" || name == "endfunction")
+      {
+        if(open_name() != name.substr(3))
+          mismatched();
+        script.next_clause[open_blocks.back()] = index;
+        open_blocks.pop_back();
+      }
+    }
+    if(!open_blocks.empty())
+    {
+      const auto& open = script.commands[open_blocks.back()];
+      throw unsupported(format("{}:{}: unterminated {}()", file_path.string(), open.line, open.name));
+    }
+    return script;
+  }
+
+  // An evaluated argument: unquoted arguments are split into list elements.
+  struct Value
+  {
+    std::string text;
+    bool is_quoted;
+  };
+
+  // Evaluates the commands of the export files, as CMake would in the generated project.
+  class Interpreter
+  {
+    std::map<std::string, std::string>& variables;
+    std::map<std::string, ImportedTarget>& targets;
+    std::vector<path>& files;
+    const Script* script = nullptr; // Being run, for errors.
+    const Command* command = nullptr;
+
+    struct Macro
+    {
+      std::shared_ptr<const Script> script;
+      std::size_t begin; // Commands of the body.
+      std::size_t end;
+      std::vector<std::string> parameters;
+    };
+    std::map<std::string, Macro> macros; // By lowercase name.
+    std::vector<std::shared_ptr<const Script>> included_scripts; // Alive as long as their macros.
+
+    enum class Flow { next, returned };
+
+    [[noreturn]] auto error(std::string_view what) const -> void
+    {
+      if(command == nullptr)
+        throw unsupported(std::string{ what });
+      throw unsupported(format("{}:{}: {}", script->file_path.string(), command->line, what));
+    }
+
+    auto variable(const std::string& name) const -> std::string
+    {
+      const auto found = variables.find(name);
+      return found == variables.end() ? std::string{} : found->second;
+    }
+
+    auto is_defined(const std::string& name) const -> bool
+    {
+      return variables.find(name) != variables.end();
+    }
+
+    // Evaluates escape sequences and variable references from `index` up to `terminator` (excluded).
+    auto expand(std::string_view text, std::size_t& index, char terminator) const -> std::string
+    {
+      std::string result;
+      while(index < text.size())
+      {
+        const auto c = text[index];
+        if(c == terminator)
+          return result;
+
+        if(c == '\\')
+        {
+          if(index + 1 >= text.size())
+            error("unterminated escape sequence");
+          const auto escaped = text[index + 1];
+          index += 2;
+          switch(escaped)
+          {
+            case 'n': result += '\n'; break;
+            case 't': result += '\t'; break;
+            case 'r': result += '\r'; break;
+            case '\n': break; // Line continuation, in quoted arguments.
+            case ';': error("escaped list separator");
+            default:
+              if(std::isalnum(static_cast<unsigned char>(escaped)))
+                error(format("invalid escape sequence \\{}", escaped));
+              result += escaped;
+          }
+          continue;
+        }
+
+        const auto rest = text.substr(index);
+        if(starts_with(rest, "${") || starts_with(rest, "$ENV{"))
+        {
+          const bool is_environment = rest[1] == 'E';
+          index += is_environment ? 5 : 2;
+          const auto name = expand(text, index, '}');
+          if(index >= text.size())
+            error("unterminated variable reference");
+          ++index;
+          if(is_environment)
+          {
+            const auto value = std::getenv(name.c_str());
+            result += value ? value : "";
+          }
+          else
+          {
+            result += variable(name);
+          }
+          continue;
+        }
+        if(starts_with(rest, "$CACHE{"))
+          error("cache variable reference");
+
+        result += c;
+        ++index;
+      }
+      if(terminator != '\0')
+        error("unterminated variable reference");
+      return result;
+    }
+
+    auto arguments(const Command& evaluated) const -> std::vector<Value>
+    {
+      std::vector<Value> values;
+      for(const auto& argument : evaluated.arguments)
+      {
+        if(argument.kind == Argument::Kind::bracket)
+        {
+          values.push_back({ argument.text, true });
+          continue;
+        }
+
+        std::size_t index = 0;
+        auto text = expand(argument.text, index, '\0');
+        if(argument.kind == Argument::Kind::quoted)
+        {
+          values.push_back({ std::move(text), true });
+          continue;
+        }
+        for(auto& element : split_list(text))
+          values.push_back({ std::move(element), false });
+      }
+      return values;
+    }
+
+    static auto texts(std::vector<Value>::const_iterator begin, std::vector<Value>::const_iterator end) -> std::vector<std::string>
+    {
+      std::vector<std::string> result;
+      for(auto value = begin; value != end; ++value)
+        result.push_back(value->text);
+      return result;
+    }
+
+    static auto is_keyword(const Value& value, std::string_view keyword) -> bool
+    {
+      return !value.is_quoted && value.text == keyword;
+    }
+
+    // Quoted arguments are never variable names (policy CMP0054, see `check_policy_version()`).
+    auto operand(const Value& value) const -> std::string
+    {
+      if(!value.is_quoted && is_defined(value.text))
+        return variable(value.text);
+      return value.text;
+    }
+
+    auto is_true(const Value& value) const -> bool
+    {
+      const auto upper = to_upper(value.text);
+      if(upper == "1" || upper == "ON" || upper == "YES" || upper == "TRUE" || upper == "Y")
+        return true;
+      if(is_off(value.text))
+        return false;
+      if(const auto number = parse_number(value.text))
+        return *number != 0;
+      if(value.is_quoted || !is_defined(value.text))
+        return false;
+      return !is_off(variable(value.text));
+    }
+
+    // Recursive descent over the `if()` arguments, with CMake's precedence: parentheses, unary tests,
+    // binary tests, NOT, AND, then OR.
+    class Condition
+    {
+      const Interpreter& interpreter;
+      const std::vector<Value>& tokens;
+      std::size_t index = 0;
+
+      auto is_next(std::string_view keyword) const -> bool
+      {
+        return index < tokens.size() && is_keyword(tokens[index], keyword);
+      }
+
+      auto take() -> const Value&
+      {
+        if(index >= tokens.size())
+          interpreter.error("incomplete condition");
+        return tokens[index++];
+      }
+
+      auto or_expression() -> bool
+      {
+        auto result = and_expression();
+        while(is_next("OR"))
+        {
+          ++index;
+          result = and_expression() || result;
+        }
+        return result;
+      }
+
+      auto and_expression() -> bool
+      {
+        auto result = not_expression();
+        while(is_next("AND"))
+        {
+          ++index;
+          result = not_expression() && result;
+        }
+        return result;
+      }
+
+      auto not_expression() -> bool
+      {
+        if(is_next("NOT"))
+        {
+          ++index;
+          return !not_expression();
+        }
+        return test();
+      }
+
+      auto test() -> bool
+      {
+        if(is_next("("))
+        {
+          ++index;
+          const auto result = or_expression();
+          if(!is_next(")"))
+            interpreter.error("unbalanced parentheses in condition");
+          ++index;
+          return result;
+        }
+
+        if(is_next("DEFINED"))
+        {
+          ++index;
+          const auto& name = take().text;
+          if(starts_with(name, "ENV{") && ends_with(name, "}"))
+            return std::getenv(name.substr(4, name.size() - 5).c_str()) != nullptr;
+          if(starts_with(name, "CACHE{"))
+            interpreter.error("if(DEFINED CACHE{...})");
+          return interpreter.is_defined(name);
+        }
+        if(is_next("TARGET"))
+        {
+          ++index;
+          return interpreter.targets.find(take().text) != interpreter.targets.end();
+        }
+        if(is_next("EXISTS") || is_next("IS_DIRECTORY") || is_next("IS_ABSOLUTE"))
+        {
+          const auto& test_name = take().text;
+          const auto& file_path = take().text;
+          if(test_name == "IS_ABSOLUTE")
+            return path(file_path).absolute();
+          if(file_path.empty())
+            return false;
+          if(!path(file_path).absolute())
+            interpreter.error(format("if({}) of a relative path", test_name));
+          if(test_name == "IS_DIRECTORY")
+            return butl::dir_exists(dir_path(file_path));
+          return butl::file_exists(path(file_path)) || butl::dir_exists(dir_path(file_path));
+        }
+        for(const auto unsupported_test : { "COMMAND", "POLICY", "IS_SYMLINK", "IS_NEWER_THAN", "TEST", "PATH_EQUAL" })
+        {
+          if(is_next(unsupported_test))
+            interpreter.error(format("if({})", unsupported_test));
+        }
+
+        const auto& left = take();
+        if(index >= tokens.size() || tokens[index].is_quoted)
+          return interpreter.is_true(left);
+
+        const auto& operation = tokens[index].text;
+        const auto compare_numbers = [&](const auto& predicate){
+          ++index;
+          const auto left_number = parse_number(interpreter.operand(left));
+          const auto right_number = parse_number(interpreter.operand(take()));
+          return left_number && right_number && predicate(*left_number, *right_number);
+        };
+        const auto compare = [&](const auto& comparison, const auto& predicate){
+          ++index;
+          const auto left_text = interpreter.operand(left);
+          return predicate(comparison(left_text, interpreter.operand(take())), 0);
+        };
+        const auto compare_strings = [](const std::string& l, const std::string& r){ return l.compare(r); };
+
+        if(operation == "EQUAL")                 return compare_numbers(std::equal_to<>{});
+        if(operation == "LESS")                  return compare_numbers(std::less<>{});
+        if(operation == "GREATER")               return compare_numbers(std::greater<>{});
+        if(operation == "LESS_EQUAL")            return compare_numbers(std::less_equal<>{});
+        if(operation == "GREATER_EQUAL")         return compare_numbers(std::greater_equal<>{});
+        if(operation == "STREQUAL")              return compare(compare_strings, std::equal_to<>{});
+        if(operation == "STRLESS")               return compare(compare_strings, std::less<>{});
+        if(operation == "STRGREATER")            return compare(compare_strings, std::greater<>{});
+        if(operation == "STRLESS_EQUAL")         return compare(compare_strings, std::less_equal<>{});
+        if(operation == "STRGREATER_EQUAL")      return compare(compare_strings, std::greater_equal<>{});
+        if(operation == "VERSION_EQUAL")         return compare(compare_versions, std::equal_to<>{});
+        if(operation == "VERSION_LESS")          return compare(compare_versions, std::less<>{});
+        if(operation == "VERSION_GREATER")       return compare(compare_versions, std::greater<>{});
+        if(operation == "VERSION_LESS_EQUAL")    return compare(compare_versions, std::less_equal<>{});
+        if(operation == "VERSION_GREATER_EQUAL") return compare(compare_versions, std::greater_equal<>{});
+        if(operation == "IN_LIST")
+        {
+          ++index;
+          const auto element = interpreter.operand(left);
+          const auto list = split_list(interpreter.variable(take().text));
+          return std::find(list.begin(), list.end(), element) != list.end();
+        }
+        if(operation == "MATCHES")
+        {
+          ++index;
+          return interpreter.matches(interpreter.operand(left), take().text);
+        }
+        return interpreter.is_true(left);
+      }
+
+    public:
+      Condition(const Interpreter& interpreter, const std::vector<Value>& tokens)
+        : interpreter(interpreter), tokens(tokens)
+      {}
+
+      auto evaluate() -> bool
+      {
+        const auto result = or_expression();
+        if(index != tokens.size())
+          interpreter.error(format("unexpected {} in condition", tokens[index].text));
+        return result;
+      }
+    };
+
+    // CMake's regular expressions are a subset of ECMAScript's, but for the escapes of character classes.
+    auto regular_expression(const std::string& expression) const -> std::regex
+    {
+      for(std::size_t index = 0; index + 1 < expression.size(); ++index)
+      {
+        if(expression[index] == '\\' && std::isalnum(static_cast<unsigned char>(expression[index + 1])))
+          error(format("regular expression {}", expression));
+      }
+      try
+      {
+        return std::regex{ expression };
+      }
+      catch(const std::regex_error&)
+      {
+        error(format("invalid regular expression {}", expression));
+      }
+    }
+
+    // Sets CMAKE_MATCH_<n> when the text matches, like `if(MATCHES)` and `string(REGEX MATCH)`.
+    auto matches(const std::string& text, const std::string& expression) const -> bool
+    {
+      std::smatch match;
+      if(!std::regex_search(text, match, regular_expression(expression)))
+        return false;
+      for(std::size_t group = 0; group < 10; ++group)
+      {
+        const auto name = format("CMAKE_MATCH_{}", group);
+        if(group < match.size())
+          variables[name] = match[group].str();
+        else
+          variables.erase(name);
+      }
+      variables["CMAKE_MATCH_COUNT"] = std::to_string(match.size() - 1);
+      return true;
+    }
+
+    // Quoted arguments are only variable names in `if()` with policies of CMake before 3.1 (CMP0054),
+    // which we don't evaluate.
+    auto check_policy_version(const std::string& versions) const -> void
+    {
+      const auto range = versions.find("...");
+      const auto maximum = range == npos ? versions : versions.substr(range + 3);
+      if(compare_versions(maximum, "3.1") < 0)
+        error(format("policies of CMake {}", maximum));
+    }
+
+    auto target(const std::string& name) const -> ImportedTarget&
+    {
+      const auto found = targets.find(name);
+      if(found == targets.end())
+        error(format("unknown target {}", name));
+      return found->second;
+    }
+
+    auto run_foreach(std::size_t index) -> Flow
+    {
+      const auto values = arguments(script->commands[index]);
+      if(values.empty())
+        error("foreach() without a loop variable");
+
+      std::vector<std::string> items;
+      if(values.size() > 1 && is_keyword(values[1], "IN"))
+      {
+        bool is_lists = false;
+        for(auto value = values.begin() + 2; value != values.end(); ++value)
+        {
+          if(is_keyword(*value, "LISTS") || is_keyword(*value, "ITEMS"))
+            is_lists = value->text == "LISTS";
+          else if(is_keyword(*value, "ZIP_LISTS"))
+            error("foreach(IN ZIP_LISTS)");
+          else if(is_lists)
+            append(items, split_list(variable(value->text)));
+          else
+            items.push_back(value->text);
+        }
+      }
+      else if(values.size() > 1 && is_keyword(values[1], "RANGE"))
+      {
+        error("foreach(RANGE)");
+      }
+      else
+      {
+        items = texts(values.begin() + 1, values.end());
+      }
+
+      // The loop variable is restored afterwards.
+      const auto& loop_variable = values[0].text;
+      const auto previous = variables.find(loop_variable);
+      const auto previous_value = previous == variables.end() ? std::optional<std::string>{} : previous->second;
+
+      const auto& loop_script = *script;
+      const auto end = loop_script.next_clause[index];
+      for(const auto& item : items)
+      {
+        variables[loop_variable] = item;
+        if(run(loop_script, index + 1, end) == Flow::returned)
+          return Flow::returned;
+      }
+
+      if(previous_value)
+        variables[loop_variable] = *previous_value;
+      else
+        variables.erase(loop_variable);
+      return Flow::next;
+    }
+
+    auto define_macro(std::size_t index) -> void
+    {
+      const auto values = arguments(script->commands[index]);
+      if(values.empty())
+        error("macro() without a name");
+
+      const auto shared_script = std::find_if(included_scripts.begin(), included_scripts.end(),
+        [&](const std::shared_ptr<const Script>& included_script){ return included_script.get() == script; });
+      if(shared_script == included_scripts.end())
+        error("macro() defined in a macro");
+      macros[to_lower(values[0].text)] = { *shared_script, index + 1, script->next_clause[index], texts(values.begin() + 1, values.end()) };
+    }
+
+    // The references to the parameters in the body are replaced by the arguments before it runs.
+    auto call_macro(const Macro& macro, const std::vector<Value>& values) -> Flow
+    {
+      if(values.size() < macro.parameters.size())
+        error(format("{}() with missing arguments", command->name));
+
+      std::vector<std::pair<std::string, std::string>> replacements;
+      const auto arguments_texts = texts(values.begin(), values.end());
+      for(std::size_t index = 0; index < macro.parameters.size(); ++index)
+        replacements.emplace_back(format("${{{}}}", macro.parameters[index]), values[index].text);
+      for(std::size_t index = 0; index < values.size(); ++index)
+        replacements.emplace_back(format("${{ARGV{}}}", index), values[index].text);
+      replacements.emplace_back("${ARGC}", std::to_string(values.size()));
+      replacements.emplace_back("${ARGV}", join_list(arguments_texts));
+      replacements.emplace_back("${ARGN}", join_list({ arguments_texts.begin() + macro.parameters.size(), arguments_texts.end() }));
+
+      Script body{ macro.script->file_path, {}, {} };
+      for(auto index = macro.begin; index < macro.end; ++index)
+      {
+        auto body_command = macro.script->commands[index];
+        for(auto& argument : body_command.arguments)
+        {
+          if(argument.kind == Argument::Kind::bracket)
+            continue;
+          for(const auto& [reference, value] : replacements)
+          {
+            for(auto found = argument.text.find(reference); found != npos; found = argument.text.find(reference, found + value.size()))
+              argument.text.replace(found, reference.size(), value);
+          }
+        }
+        body.commands.push_back(std::move(body_command));
+        const auto next = macro.script->next_clause[index];
+        body.next_clause.push_back(next == npos ? npos : next - macro.begin);
+      }
+
+      const auto caller_script = script;
+      const auto caller_command = command;
+      const auto flow = run(body, 0, body.commands.size());
+      script = caller_script;
+      command = caller_command;
+      return flow;
+    }
+
+    auto run(const Script& running_script, std::size_t begin, std::size_t end) -> Flow
+    {
+      for(auto index = begin; index < end;)
+      {
+        script = &running_script;
+        command = &running_script.commands[index];
+        const auto& name = command->name;
+
+        if(name == "if")
+        {
+          // Only the conditions up to the branch taken are evaluated.
+          auto clause = index;
+          bool is_taken = false;
+          while(running_script.commands[clause].name != "endif")
+          {
+            const auto next = running_script.next_clause[clause];
+            script = &running_script;
+            command = &running_script.commands[clause];
+            if(!is_taken && (command->name == "else" || Condition{ *this, arguments(*command) }.evaluate()))
+            {
+              is_taken = true;
+              if(run(running_script, clause + 1, next) == Flow::returned)
+                return Flow::returned;
+            }
+            clause = next;
+          }
+          index = clause + 1;
+        }
+        else if(name == "foreach")
+        {
+          if(run_foreach(index) == Flow::returned)
+            return Flow::returned;
+          index = running_script.next_clause[index] + 1;
+        }
+        else if(name == "macro")
+        {
+          define_macro(index);
+          index = running_script.next_clause[index] + 1;
+        }
+        else if(name == "return")
+        {
+          return Flow::returned;
+        }
+        else if(const auto macro = macros.find(name); macro != macros.end())
+        {
+          if(call_macro(macro->second, arguments(*command)) == Flow::returned)
+            return Flow::returned;
+          ++index;
+        }
+        else
+        {
+          execute(arguments(*command));
+          ++index;
+        }
+      }
+      return Flow::next;
+    }
+
+    auto execute(const std::vector<Value>& values) -> void
+    {
+      const auto& name = command->name;
+      const auto require_arguments = [&](std::size_t count){
+        if(values.size() < count)
+          error(format("{}() with missing arguments", name));
+      };
+
+      if(name == "set")
+      {
+        require_arguments(1);
+        const auto& variable_name = values[0].text;
+        if(starts_with(variable_name, "ENV{"))
+          error("set(ENV{...})");
+        for(auto value = values.begin() + 1; value != values.end(); ++value)
+        {
+          if(is_keyword(*value, "CACHE") || is_keyword(*value, "PARENT_SCOPE"))
+            error(format("set(... {})", value->text));
+        }
+
+        if(values.size() == 1)
+          variables.erase(variable_name);
+        else
+          variables[variable_name] = join_list(texts(values.begin() + 1, values.end()));
+      }
+      else if(name == "unset")
+      {
+        require_arguments(1);
+        if(values.size() > 1 || starts_with(values[0].text, "ENV{"))
+          error("unset() of a cache or environment variable");
+        variables.erase(values[0].text);
+      }
+      else if(name == "list")
+      {
+        require_arguments(2);
+        if(values[0].text != "APPEND")
+          error(format("list({})", values[0].text));
+        auto elements = split_list(variable(values[1].text));
+        append(elements, texts(values.begin() + 2, values.end()));
+        variables[values[1].text] = join_list(elements);
+      }
+      else if(name == "string" && values.size() > 1 && values[0].text == "REGEX")
+      {
+        require_arguments(5);
+        const auto& mode = values[1].text;
+        const auto input = [&](std::size_t first){
+          std::string text;
+          for(auto value = values.begin() + first; value < values.end(); ++value)
+            text += value->text;
+          return text;
+        };
+        if(mode == "MATCH")
+        {
+          const auto text = input(4);
+          variables[values[3].text] = matches(text, values[2].text) ? variable("CMAKE_MATCH_0") : std::string{};
+        }
+        else if(mode == "REPLACE" && values.size() > 5)
+        {
+          // `\<n>` references a group, `$` has no special meaning.
+          std::string replacement;
+          const auto& cmake_replacement = values[3].text;
+          for(std::size_t index = 0; index < cmake_replacement.size(); ++index)
+          {
+            const auto c = cmake_replacement[index];
+            if(c == '\\' && index + 1 < cmake_replacement.size() && std::isdigit(static_cast<unsigned char>(cmake_replacement[index + 1])))
+              replacement += '$';
+            else if(c == '$')
+              replacement += "$$";
+            else
+              replacement += c;
+          }
+          variables[values[4].text] = std::regex_replace(input(5), regular_expression(values[2].text), replacement);
+        }
+        else
+        {
+          error(format("string(REGEX {})", mode));
+        }
+      }
+      else if(name == "string")
+      {
+        require_arguments(4);
+        if(values[0].text != "REPLACE")
+          error(format("string({})", values[0].text));
+        const auto& match = values[1].text;
+        const auto& replacement = values[2].text;
+        if(match.empty())
+          error("string(REPLACE) of an empty string");
+
+        std::string input;
+        for(auto value = values.begin() + 4; value != values.end(); ++value)
+          input += value->text;
+        std::string result;
+        std::size_t position = 0;
+        for(auto found = input.find(match); found != npos; found = input.find(match, position))
+        {
+          result.append(input, position, found - position).append(replacement);
+          position = found + match.size();
+        }
+        result.append(input, position);
+        variables[values[3].text] = result;
+      }
+      else if(name == "get_filename_component")
+      {
+        require_arguments(3);
+        if(values.size() > 3)
+          error("get_filename_component() with options");
+        const auto& file_path = values[1].text;
+        const auto& mode = values[2].text;
+        std::string result;
+        if(mode == "PATH" || mode == "DIRECTORY")
+          result = directory_part(file_path);
+        else if(mode == "NAME")
+          result = file_path.substr(file_path.rfind('/') + 1);
+        else if((mode == "ABSOLUTE" || mode == "REALPATH") && path(file_path).absolute())
+          result = mode == "ABSOLUTE" ? normalized(file_path) : path(file_path).realize().string();
+        else
+          error(format("get_filename_component({} {})", file_path, mode));
+        variables[values[0].text] = result;
+      }
+      else if(name == "get_target_property")
+      {
+        require_arguments(3);
+        const auto& properties = target(values[1].text).properties;
+        const auto found = properties.find(values[2].text);
+        variables[values[0].text] = found == properties.end() ? values[0].text + "-NOTFOUND" : found->second;
+      }
+      else if(name == "file")
+      {
+        require_arguments(2);
+        if(values[0].text != "GLOB")
+          error(format("file({})", values[0].text));
+        glob(values);
+      }
+      else if(name == "include")
+      {
+        require_arguments(1);
+        bool is_optional = false;
+        for(auto value = values.begin() + 1; value != values.end(); ++value)
+        {
+          if(is_keyword(*value, "OPTIONAL"))
+            is_optional = true;
+          else if(!is_keyword(*value, "NO_POLICY_SCOPE"))
+            error(format("include(... {})", value->text));
+        }
+
+        const auto file_path = path(values[0].text);
+        if(!file_path.absolute())
+          error(format("include({}) of a module or a relative path", values[0].text));
+        if(!butl::file_exists(file_path))
+        {
+          if(!is_optional)
+            error(format("include({}) of a missing file", values[0].text));
+          return;
+        }
+        include(file_path);
+      }
+      else if(name == "message")
+      {
+        if(!values.empty() && (is_keyword(values[0], "FATAL_ERROR") || is_keyword(values[0], "SEND_ERROR")))
+          error(format("message({}): {}", values[0].text, values.size() > 1 ? values[1].text : std::string{}));
+      }
+      else if(name == "cmake_policy")
+      {
+        require_arguments(1);
+        const auto& mode = values[0].text;
+        if(mode == "VERSION")
+        {
+          require_arguments(2);
+          check_policy_version(values[1].text);
+        }
+        else if(mode == "SET")
+        {
+          require_arguments(3);
+          if(values[2].text != "NEW")
+            error(format("cmake_policy(SET {} {})", values[1].text, values[2].text));
+        }
+        else if(mode != "PUSH" && mode != "POP")
+        {
+          error(format("cmake_policy({})", mode));
+        }
+      }
+      else if(name == "cmake_minimum_required")
+      {
+        require_arguments(2);
+        check_policy_version(values[1].text);
+      }
+      else if(name == "include_guard")
+      {
+        // Each file is only included once per package.
+      }
+      else if(name == "add_library" || name == "add_executable")
+      {
+        const auto is_library = name == "add_library";
+        require_arguments(is_library ? 3 : 2);
+        const auto& type = is_library ? values[1].text : std::string{ "EXECUTABLE" };
+        const auto& imported = values[is_library ? 2 : 1];
+        if(!is_keyword(imported, "IMPORTED") || values.size() > (is_library ? 4u : 3u))
+          error(format("{}() of a target which is not imported", name));
+        if(targets.find(values[0].text) != targets.end())
+          error(format("target {} already exists", values[0].text));
+        targets[values[0].text].type = type;
+      }
+      else if(name == "set_target_properties")
+      {
+        const auto properties = std::find_if(values.begin(), values.end(), [](const Value& value){ return is_keyword(value, "PROPERTIES"); });
+        if(properties == values.end() || (values.end() - properties - 1) % 2 != 0)
+          error("set_target_properties() with missing arguments");
+        for(auto target_name = values.begin(); target_name != properties; ++target_name)
+        {
+          auto& imported_target = target(target_name->text);
+          for(auto property = properties + 1; property != values.end(); property += 2)
+            imported_target.properties[property->text] = (property + 1)->text;
+        }
+      }
+      else if(name == "set_property")
+      {
+        require_arguments(1);
+        if(!is_keyword(values[0], "TARGET"))
+          error(format("set_property({})", values[0].text));
+        const auto property = std::find_if(values.begin(), values.end(), [](const Value& value){ return is_keyword(value, "PROPERTY"); });
+        if(property == values.end() || property + 1 == values.end())
+          error("set_property() with missing arguments");
+
+        bool is_append = false;
+        std::vector<ImportedTarget*> property_targets;
+        for(auto value = values.begin() + 1; value != property; ++value)
+        {
+          if(is_keyword(*value, "APPEND"))
+            is_append = true;
+          else if(is_keyword(*value, "APPEND_STRING"))
+            error("set_property(APPEND_STRING)");
+          else
+            property_targets.push_back(&target(value->text));
+        }
+
+        const auto& property_name = (property + 1)->text;
+        const auto property_values = texts(property + 2, values.end());
+        for(auto imported_target : property_targets)
+        {
+          auto elements = is_append ? split_list(imported_target->properties[property_name]) : std::vector<std::string>{};
+          append(elements, property_values);
+          imported_target->properties[property_name] = join_list(elements);
+        }
+      }
+      else
+      {
+        error(format("{}()", name));
+      }
+    }
+
+    // `file(GLOB <variable> [LIST_DIRECTORIES <bool>] [CONFIGURE_DEPENDS] <expressions>...)`,
+    // with wildcards only in the file names.
+    auto glob(const std::vector<Value>& values) -> void
+    {
+      bool list_directories = true;
+      std::vector<std::string> matches;
+      for(auto value = values.begin() + 2; value != values.end(); ++value)
+      {
+        if(is_keyword(*value, "CONFIGURE_DEPENDS"))
+          continue;
+        if(is_keyword(*value, "LIST_DIRECTORIES") && value + 1 != values.end())
+        {
+          ++value;
+          list_directories = !is_off(value->text);
+          continue;
+        }
+        if(is_keyword(*value, "RELATIVE"))
+          error("file(GLOB RELATIVE)");
+
+        const auto expression = path(value->text);
+        const auto directory = expression.directory();
+        if(!expression.absolute() || directory.string().find_first_of("*?[") != std::string::npos)
+          error(format("file(GLOB {})", value->text));
+        if(!butl::dir_exists(directory))
+          continue;
+
+        butl::path_search(expression.leaf(), [&](path entry, const std::string&, bool){
+          if(list_directories || !butl::dir_exists(directory / dir_path(entry.string())))
+            matches.push_back((directory / path(entry.string())).string());
+          return true;
+        }, directory);
+      }
+
+      std::sort(matches.begin(), matches.end());
+      matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+      variables[values[1].text] = join_list(matches);
+    }
+
+  public:
+    Interpreter(std::map<std::string, std::string>& variables, std::map<std::string, ImportedTarget>& targets, std::vector<path>& files)
+      : variables(variables), targets(targets), files(files)
+    {}
+
+    // Runs the file like `include()`: in the current scope, with its own CMAKE_CURRENT_LIST_FILE and DIR.
+    auto include(const path& file_path) -> void
+    {
+      const auto caller_script = script;
+      const auto caller_command = command;
+      const auto caller_file = variable("CMAKE_CURRENT_LIST_FILE");
+      const auto caller_directory = variable("CMAKE_CURRENT_LIST_DIR");
+
+      files.push_back(file_path);
+      included_scripts.push_back(std::make_shared<const Script>(parse_script(file_path)));
+      const auto& included_script = *included_scripts.back();
+      variables["CMAKE_CURRENT_LIST_FILE"] = file_path.string();
+      variables["CMAKE_CURRENT_LIST_DIR"] = directory_part(file_path.string());
+      run(included_script, 0, included_script.commands.size());
+
+      variables["CMAKE_CURRENT_LIST_FILE"] = caller_file;
+      variables["CMAKE_CURRENT_LIST_DIR"] = caller_directory;
+      script = caller_script;
+      command = caller_command;
+    }
+  };
+
+  // Values of the `set()` commands of a platform file, which are all literal.
+  auto read_platform_variables(const path& file_path) -> std::map<std::string, std::string>
+  {
+    std::map<std::string, std::string> variables;
+    for(const auto& command : parse_script(file_path).commands)
+    {
+      if(command.name != "set" || command.arguments.size() < 2 || variables.count(command.arguments[0].text))
+        continue;
+      std::vector<std::string> values;
+      for(auto argument = command.arguments.begin() + 1; argument != command.arguments.end(); ++argument)
+        values.push_back(argument->text);
+      variables[command.arguments[0].text] = join_list(values);
+    }
+    return variables;
+  }
+
+  // Directories where the linker looks for libraries anyway, see CMake's Modules/Platform/UnixPaths.cmake.
+  constexpr const char* platform_implicit_link_directories[] = { "/lib", "/lib32", "/lib64", "/usr/lib", "/usr/lib32", "/usr/lib64" };
+
+  // Properties of imported targets whose effect on the usage requirements is known.
+  auto is_known_property(const std::string& name) -> bool
+  {
+    return name == "INTERFACE_INCLUDE_DIRECTORIES" || name == "INTERFACE_COMPILE_DEFINITIONS" || name == "INTERFACE_LINK_LIBRARIES"
+        || name == "IMPORTED_CONFIGURATIONS" || starts_with(name, "IMPORTED_LOCATION") || starts_with(name, "IMPORTED_SONAME")
+        || starts_with(name, "IMPORTED_LINK_INTERFACE_LANGUAGES");
+  }
+
+  auto property(const ImportedTarget& target, const std::string& name) -> const std::string*
+  {
+    const auto found = target.properties.find(name);
+    return found == target.properties.end() ? nullptr : &found->second;
+  }
+
+  // Like `cmTarget::GetMappedConfig()` without mappings: the location for the configuration,
+  // or without configuration, or for any configuration.
+  auto imported_location(const std::string& target_name, const ImportedTarget& target, const std::string& configuration) -> std::string
+  {
+    const auto suffix = configuration.empty() ? std::string{ "NOCONFIG" } : to_upper(configuration);
+    if(const auto location = property(target, "IMPORTED_LOCATION_" + suffix))
+      return *location;
+    if(const auto location = property(target, "IMPORTED_LOCATION"))
+      return *location;
+    if(const auto configurations = property(target, "IMPORTED_CONFIGURATIONS"))
+    {
+      for(const auto& imported_configuration : split_list(*configurations))
+      {
+        if(const auto location = property(target, "IMPORTED_LOCATION_" + to_upper(imported_configuration)))
+          return *location;
+      }
+    }
+    throw unsupported(format("imported target {} has no location", target_name));
+  }
+
+}
+
+  auto compare_versions(std::string_view left, std::string_view right) -> int
+  {
+    const auto next_component = [](std::string_view& version) -> unsigned long {
+      const auto separator = version.find('.');
+      const auto component = std::string(version.substr(0, separator));
+      version = separator == npos ? std::string_view{} : version.substr(separator + 1);
+      return std::strtoul(component.c_str(), nullptr, 10);
+    };
+    while(!left.empty() || !right.empty())
+    {
+      const auto left_component = next_component(left);
+      const auto right_component = next_component(right);
+      if(left_component != right_component)
+        return left_component < right_component ? -1 : 1;
+    }
+    return 0;
+  }
+
+  auto read_platform(const dir_path& platform_files_path) -> Platform
+  {
+    const auto system = read_platform_variables(platform_files_path / path("CMakeSystem.cmake"));
+    const auto compiler = read_platform_variables(platform_files_path / path("CMakeCXXCompiler.cmake"));
+    const auto value = [](const std::map<std::string, std::string>& variables, const std::string& name){
+      const auto found = variables.find(name);
+      return found == variables.end() ? std::string{} : found->second;
+    };
+
+    Platform platform;
+    platform.cmake_version = platform_files_path.leaf().string();
+    platform.system_name = value(system, "CMAKE_SYSTEM_NAME");
+    platform.library_architecture = value(compiler, "CMAKE_CXX_LIBRARY_ARCHITECTURE");
+    platform.sizeof_void_p = value(compiler, "CMAKE_CXX_SIZEOF_DATA_PTR");
+    platform.implicit_include_directories = split_list(value(compiler, "CMAKE_CXX_IMPLICIT_INCLUDE_DIRECTORIES"));
+    platform.implicit_link_directories = split_list(value(compiler, "CMAKE_CXX_IMPLICIT_LINK_DIRECTORIES"));
+    for(const auto directory : platform_implicit_link_directories)
+      platform.implicit_link_directories.push_back(directory);
+    return platform;
+  }
+
+  auto link_libraries(const std::string& target_name, const std::map<std::string, LinkedTarget>& closure,
+                      const std::vector<std::string>& implicit_link_directories) -> std::vector<std::string>
+  {
+    const auto is_implicit_link_directory = [&](const std::string& directory){
+      return std::any_of(implicit_link_directories.begin(), implicit_link_directories.end(), [&](const std::string& implicit_directory){
+        return normalized(implicit_directory) == normalized(directory);
+      });
+    };
+
+    // Each item before the items it depends on, in the order CMake keeps them: the reverse
+    // of a depth-first post-order visiting the dependencies from the last.
+    std::vector<std::string> post_order;
+    std::set<std::string> visited;
+    std::set<std::string> visiting;
+    std::function<void(const std::string&)> visit = [&](const std::string& item){
+      if(visited.count(item))
+        return;
+      const auto found = closure.find(item);
+      if(found != closure.end())
+      {
+        if(!visiting.insert(item).second)
+          throw unsupported(format("target {} depends on itself", item));
+        const auto& dependencies = found->second.link_items;
+        for(auto dependency = dependencies.rbegin(); dependency != dependencies.rend(); ++dependency)
+          visit(*dependency);
+        visiting.erase(item);
+      }
+      else if(item.find("::") != std::string::npos)
+      {
+        throw unsupported(format("{} is not a target", item));
+      }
+      visited.insert(item);
+      post_order.push_back(item);
+    };
+    if(closure.find(target_name) == closure.end())
+      throw unsupported(format("{} is not a target", target_name));
+    visit(target_name);
+
+    std::vector<std::string> libraries;
+    std::vector<std::string> runtime_directories;
+    for(auto item = post_order.rbegin(); item != post_order.rend(); ++item)
+    {
+      const auto found = closure.find(*item);
+      if(found == closure.end())
+      {
+        const auto item_path = path(*item);
+        if(item_path.absolute() && !butl::file_exists(item_path)) // CMake links it with `-l<name>` if it can.
+          throw unsupported(format("link item {} does not exist", *item));
+        if(item_path.absolute() && (ends_with(*item, ".a") || is_implicit_link_directory(directory_part(*item))))
+          libraries.push_back(*item);
+        else if(item->find_first_of("/\\-$") == std::string::npos && !item_path.absolute())
+          libraries.push_back("-l" + *item);
+        else
+          throw unsupported(format("link item {}", *item));
+        continue;
+      }
+
+      const auto& target = found->second;
+      if(target.type == "INTERFACE")
+        continue;
+      if(target.type != "SHARED" && target.type != "STATIC")
+        throw unsupported(format("target {} has the type {}", *item, target.type));
+      libraries.push_back(target.linker_file);
+      const auto location_directory = directory_part(target.linker_file);
+      if(target.type == "SHARED" && !is_implicit_link_directory(location_directory)
+      && std::find(runtime_directories.begin(), runtime_directories.end(), location_directory) == runtime_directories.end())
+        runtime_directories.push_back(location_directory);
+    }
+    if(!runtime_directories.empty())
+      libraries.insert(libraries.begin(), format("-Wl,-rpath,{}", fmt::join(runtime_directories, ":")));
+    return libraries;
+  }
+
+  auto find_package_configuration_file(const std::string& package_name, const std::vector<dir_path>& prefixes,
+                                       const dir_path& cmake_modules_path, const Platform& platform) -> path
+  {
+    if(!cmake_modules_path.empty() && butl::file_exists(cmake_modules_path / path(format("Find{}.cmake", package_name))))
+      throw unsupported(format("CMake has a find module for {}", package_name));
+    if(std::getenv(format("{}_ROOT", package_name).c_str()) != nullptr)
+      throw unsupported(format("{}_ROOT is set in the environment", package_name));
+
+    // The search procedure of `find_package()`, in each prefix, where `<name>*` are the directories whose
+    // name starts with the package name, ignoring case:
+    //   <prefix>/[<name>*/][(cmake|CMake)/[<name>*/]]
+    //   <prefix>/[<name>*/](lib/<arch>|lib*|share)/(cmake/<name>*/|<name>*/[(cmake|CMake)/])
+    // Whether lib32, lib64 and libx32 are searched depends on the platform: what is found there needs CMake.
+    const auto lower_name = to_lower(package_name);
+    const std::string file_names[] = { package_name + "Config.cmake", lower_name + "-config.cmake" };
+
+    const auto name_directories = [&](const dir_path& directory){
+      std::vector<dir_path> directories;
+      if(!butl::dir_exists(directory))
+        return directories;
+      butl::path_search(path("*/"), [&](path entry, const std::string&, bool){
+        const auto entry_name = dir_path(entry.string()).leaf().string();
+        if(starts_with(to_lower(entry_name), lower_name))
+          directories.push_back(directory / dir_path(entry_name));
+        return true;
+      }, directory);
+      return directories;
+    };
+
+    for(const auto& prefix : prefixes)
+    {
+      std::vector<std::pair<path, bool>> candidates; // Whether CMake certainly searches there.
+      const auto add_candidates = [&](const dir_path& directory, bool is_certain){
+        for(const auto& file_name : file_names)
+        {
+          const auto file_path = directory / path(file_name);
+          if(butl::file_exists(file_path))
+            candidates.emplace_back(file_path, is_certain);
+        }
+      };
+      const auto add_cmake_candidates = [&](const dir_path& directory, bool is_certain){
+        for(const auto cmake_directory : { "cmake", "CMake" })
+          add_candidates(directory / dir_path(cmake_directory), is_certain);
+      };
+
+      add_candidates(prefix, true);
+      add_cmake_candidates(prefix, true);
+      auto bases = name_directories(prefix);
+      for(const auto& name_directory : bases)
+      {
+        add_candidates(name_directory, true);
+        add_cmake_candidates(name_directory, true);
+        for(const auto cmake_directory : { "cmake", "CMake" })
+          for(const auto& nested_directory : name_directories(name_directory / dir_path(cmake_directory)))
+            add_candidates(nested_directory, true);
+      }
+      bases.insert(bases.begin(), prefix);
+
+      std::vector<std::pair<dir_path, bool>> library_directories = {
+        { dir_path("lib"), true }, { dir_path("share"), true },
+        { dir_path("lib32"), false }, { dir_path("lib64"), false }, { dir_path("libx32"), false },
+      };
+      if(!platform.library_architecture.empty())
+        library_directories.emplace_back(dir_path("lib") / dir_path(platform.library_architecture), true);
+
+      for(const auto& base : bases)
+      {
+        for(const auto& [library_directory, is_certain] : library_directories)
+        {
+          for(const auto& name_directory : name_directories(base / library_directory / dir_path("cmake")))
+            add_candidates(name_directory, is_certain);
+          for(const auto& name_directory : name_directories(base / library_directory))
+          {
+            add_candidates(name_directory, is_certain);
+            add_cmake_candidates(name_directory, is_certain);
+          }
+        }
+      }
+
+      if(candidates.empty())
+        continue;
+      if(candidates.size() > 1)
+        throw unsupported(format("several configuration files of {} in {}", package_name, prefix.string()));
+      if(!candidates.front().second)
+        throw unsupported(format("{} may not be searched by CMake on this platform", candidates.front().first.string()));
+      return candidates.front().first;
+    }
+    throw unsupported(format("no configuration file of {} in CMAKE_PREFIX_PATH", package_name));
+  }
+
+  ExportFilesReader::ExportFilesReader(Platform platform)
+    : platform(std::move(platform))
+  {
+    // What the generated project defines before the `find_package()` calls and the export files rely on.
+    const auto& version = this->platform.cmake_version;
+    variables["CMAKE_VERSION"] = version;
+    const auto components = [&]{
+      std::vector<std::string> result;
+      std::string_view rest = version;
+      while(!rest.empty())
+      {
+        const auto separator = rest.find('.');
+        result.emplace_back(rest.substr(0, separator));
+        rest = separator == npos ? std::string_view{} : rest.substr(separator + 1);
+      }
+      result.resize(3, "0");
+      return result;
+    }();
+    variables["CMAKE_MAJOR_VERSION"] = components[0];
+    variables["CMAKE_MINOR_VERSION"] = components[1];
+    variables["CMAKE_PATCH_VERSION"] = components[2];
+    variables["CMAKE_SYSTEM_NAME"] = this->platform.system_name;
+    variables["CMAKE_SIZEOF_VOID_P"] = this->platform.sizeof_void_p;
+    if(!this->platform.library_architecture.empty())
+      variables["CMAKE_LIBRARY_ARCHITECTURE"] = this->platform.library_architecture;
+    if(this->platform.system_name == "Linux")
+      variables["UNIX"] = variables["LINUX"] = "1";
+  }
+
+  auto ExportFilesReader::read_package(const std::string& package_name, const path& configuration_file) -> void
+  {
+    TraceSpan span{ "read_package" };
+    span.arg("package", package_name).arg("file", configuration_file.string());
+    const auto directory = configuration_file.directory();
+
+    // Like `find_package()`: the version file decides if the package is suitable, in a scope of its own.
+    const auto is_lowercase_file = configuration_file.leaf().string() == to_lower(package_name) + "-config.cmake";
+    const auto version_file_names = is_lowercase_file
+      ? std::vector<std::string>{ to_lower(package_name) + "-config-version.cmake", to_lower(package_name) + "-configVersion.cmake" }
+      : std::vector<std::string>{ package_name + "ConfigVersion.cmake", package_name + "Config-version.cmake" };
+    for(const auto& version_file_name : version_file_names)
+    {
+      const auto version_file = directory / path(version_file_name);
+      if(!butl::file_exists(version_file))
+        continue;
+
+      auto version_scope = variables;
+      version_scope["PACKAGE_FIND_NAME"] = package_name;
+      version_scope["PACKAGE_FIND_VERSION"] = "";
+      for(const auto component : { "MAJOR", "MINOR", "PATCH", "TWEAK" })
+        version_scope[format("PACKAGE_FIND_VERSION_{}", component)] = "0";
+      version_scope["PACKAGE_FIND_VERSION_COUNT"] = "0";
+      auto version_targets = targets;
+      Interpreter{ version_scope, version_targets, files }.include(version_file);
+
+      if(!is_off(version_scope["PACKAGE_VERSION_UNSUITABLE"]))
+        throw unsupported(format("{} is not suitable according to {}", package_name, version_file.string()));
+      variables[package_name + "_VERSION"] = version_scope["PACKAGE_VERSION"];
+      break;
+    }
+
+    variables["CMAKE_FIND_PACKAGE_NAME"] = package_name;
+    variables[package_name + "_DIR"] = directory.string();
+    variables[package_name + "_CONFIG"] = configuration_file.string();
+    variables[package_name + "_FIND_REQUIRED"] = "1";
+    variables[package_name + "_FOUND"] = "1";
+    Interpreter{ variables, targets, files }.include(configuration_file);
+    variables.erase("CMAKE_FIND_PACKAGE_NAME");
+
+    if(is_off(variables[package_name + "_FOUND"]))
+      throw unsupported(format("{} sets {}_FOUND to false", configuration_file.string(), package_name));
+  }
+
+  auto usage_requirements(const std::map<std::string, ImportedTarget>& targets, const Platform& platform,
+                          const std::string& target_name, const std::string& configuration) -> Target
+  {
+    const auto imported_target = [&](const std::string& name) -> const ImportedTarget& {
+      const auto found = targets.find(name);
+      if(found == targets.end())
+        throw unsupported(format("{} is not an imported target", name));
+      return found->second;
+    };
+
+    // Link items of a target, in order: other targets, or what the linker is given directly.
+    const auto link_items = [&](const std::string& name){
+      const auto& target = imported_target(name);
+      for(const auto& [property_name, value] : target.properties)
+      {
+        if(!is_known_property(property_name))
+          throw unsupported(format("imported target {} has the property {}", name, property_name));
+        if(value.find("$<") != std::string::npos)
+          throw unsupported(format("property {} of {} has generator expressions", property_name, name));
+        if(starts_with(property_name, "IMPORTED_LINK_INTERFACE_LANGUAGES"))
+        {
+          for(const auto& language : split_list(value))
+            if(language != "C" && language != "CXX")
+              throw unsupported(format("imported target {} needs the {} linker", name, language));
+        }
+      }
+      if(target.type != "SHARED" && target.type != "STATIC" && target.type != "INTERFACE")
+        throw unsupported(format("imported target {} is a {} one", name, to_lower(target.type)));
+
+      const auto libraries = property(target, "INTERFACE_LINK_LIBRARIES");
+      return libraries ? split_list(*libraries) : std::vector<std::string>{};
+    };
+
+    // The targets the executable links to, with what each one links to.
+    std::map<std::string, LinkedTarget> closure;
+    std::function<void(const std::string&)> add = [&](const std::string& name){
+      if(closure.count(name))
+        return;
+      auto& linked_target = closure[name]; // Before its dependencies, which can depend on it.
+      const auto& target = imported_target(name);
+      linked_target.link_items = link_items(name);
+      linked_target.type = target.type;
+      if(target.type != "INTERFACE")
+        linked_target.linker_file = imported_location(name, target, configuration);
+      for(const auto& item : linked_target.link_items)
+      {
+        if(targets.find(item) != targets.end())
+          add(item);
+      }
+    };
+    add(target_name);
+
+    Target result;
+    result.link_libraries = link_libraries(target_name, closure, platform.implicit_link_directories);
+
+    // Usage requirements of the target, then of its dependencies, first ones first.
+    auto& compilation = result.language_compilation["CXX"];
+    std::set<std::string> defines;
+    std::set<std::string> collected;
+    std::function<void(const std::string&)> collect = [&](const std::string& name){
+      const auto found = targets.find(name);
+      if(found == targets.end() || !collected.insert(name).second)
+        return;
+      const auto& target = found->second;
+      if(const auto directories = property(target, "INTERFACE_INCLUDE_DIRECTORIES"))
+      {
+        for(const auto& directory : split_list(*directories))
+        {
+          if(!path(directory).absolute() || !butl::dir_exists(dir_path(directory)))
+            throw unsupported(format("include directory {} of {} is not an existing absolute path", directory, name));
+          const auto include_directory = normalized(directory);
+          const auto& implicit_directories = platform.implicit_include_directories;
+          if(std::find(implicit_directories.begin(), implicit_directories.end(), include_directory) != implicit_directories.end())
+            continue; // Like CMake, which doesn't report them either.
+          if(std::find(compilation.include_directories.begin(), compilation.include_directories.end(), include_directory)
+             == compilation.include_directories.end())
+            compilation.include_directories.push_back(include_directory);
+        }
+      }
+      if(const auto definitions = property(target, "INTERFACE_COMPILE_DEFINITIONS"))
+      {
+        for(const auto& definition : split_list(*definitions))
+          defines.insert(starts_with(definition, "-D") ? definition.substr(2) : definition);
+      }
+      for(const auto& dependency : link_items(name))
+        collect(dependency);
+    };
+    collect(target_name);
+    compilation.defines.assign(defines.begin(), defines.end());
+    return result;
+  }
+
+  auto ExportFilesReader::usage_requirements(const std::string& target_name, const std::string& configuration) const -> Target
+  {
+    return detail::usage_requirements(targets, platform, target_name, configuration);
+  }
+
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <libwyvern/wyvern.hpp>
+#include <libwyvern/utility.hpp>
+#include <libwyvern/export.hpp>
+
+namespace wyvern::detail {
+
+  // Reading the information of installed packages directly from their export files (see `install(EXPORT)`),
+  // without running CMake (see `Options::read_export_files`). These files mostly declare imported targets and
+  // set their properties, which a small interpreter of the CMake language evaluates. Whatever it cannot evaluate
+  // exactly as CMake would throws `unsupported`: the extraction then runs CMake.
+
+  struct unsupported : failure
+  {
+    using failure::failure;
+  };
+
+  // What the reader needs to know about the toolchain, from its platform files (see `probe_toolchain()`).
+  struct Platform
+  {
+    std::string cmake_version; // Of the CMake which detected it.
+    std::string system_name;
+    std::string library_architecture;
+    std::string sizeof_void_p;
+    std::vector<std::string> implicit_include_directories; // Never passed to the compiler.
+    std::vector<std::string> implicit_link_directories; // Not added to the runtime path.
+  };
+
+  // Like `cmSystemTools::VersionCompare()`: numeric components separated by dots, missing ones are 0.
+  LIBWYVERN_SYMEXPORT
+  auto compare_versions(std::string_view left, std::string_view right) -> int;
+
+  // Reads the platform files written in CMakeFiles/<cmake-version>/ when CMake detected the toolchain.
+  LIBWYVERN_SYMEXPORT
+  auto read_platform(const dir_path& platform_files_path) -> Platform;
+
+  // Finds the configuration file of the package in the prefixes, where `find_package(<package_name>)` finds it first.
+  // Throws `unsupported` if CMake could find it elsewhere: with a find module of CMake (`cmake_modules_path`),
+  // a `<package_name>_ROOT` environment variable, or if a prefix has several candidates.
+  LIBWYVERN_SYMEXPORT
+  auto find_package_configuration_file(const std::string& package_name, const std::vector<dir_path>& prefixes,
+                                       const dir_path& cmake_modules_path, const Platform& platform) -> path;
+
+  // A target of the link closure of an executable, with what CMake links for it.
+  struct LinkedTarget
+  {
+    std::string type; // SHARED, STATIC or INTERFACE, the others are unsupported.
+    std::string linker_file; // Empty for INTERFACE targets.
+    std::vector<std::string> link_items; // In order: other targets of the closure, or what the linker is given directly.
+  };
+
+  // The link libraries of an executable linked to the target, as CMake orders them: each item before the items it depends on,
+  // after the runtime path of the shared libraries outside of the implicit link directories. Also used with the closures
+  // CMake evaluated itself (see `read_usage_dumps()`).
+  LIBWYVERN_SYMEXPORT
+  auto link_libraries(const std::string& target_name, const std::map<std::string, LinkedTarget>& closure,
+                      const std::vector<std::string>& implicit_link_directories) -> std::vector<std::string>;
+
+  struct ImportedTarget
+  {
+    std::string type; // SHARED, STATIC, INTERFACE...
+    std::map<std::string, std::string> properties; // Values are lists, separated by ';'.
+  };
+
+  // What an executable compiled as C++ and linked to the imported target uses, as the extraction with CMake
+  // would find it, for the configuration (the build type, empty if none). Also used with the targets
+  // reconstructed from CMake's trace (see `TraceReader`).
+  LIBWYVERN_SYMEXPORT
+  auto usage_requirements(const std::map<std::string, ImportedTarget>& targets, const Platform& platform,
+                          const std::string& target_name, const std::string& configuration) -> Target;
+
+  class LIBWYVERN_SYMEXPORT ExportFilesReader
+  {
+    Platform platform;
+    std::map<std::string, std::string> variables; // Of the directory scope, shared by the packages like in the generated project.
+    std::map<std::string, ImportedTarget> targets;
+    std::vector<path> files;
+
+  public:
+    explicit ExportFilesReader(Platform platform);
+
+    // Evaluates the configuration file of the package, as `find_package()` would.
+    auto read_package(const std::string& package_name, const path& configuration_file) -> void;
+
+    // See the free function, with the targets of the packages read.
+    auto usage_requirements(const std::string& target_name, const std::string& configuration) const -> Target;
+
+    // Files read so far, the information depends on them.
+    auto files_read() const -> const std::vector<path>& { return files; }
+  };
+
+}
@@ -0,0 +1,423 @@
+#include <libwyvern/file-api.hpp>
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <thread>
+
+#include <libbutl/filesystem.mxx>
+
+#include <libwyvern/utility.hpp>
+#include <libwyvern/trace.hpp>
+
+namespace wyvern::cmake {
+
+  using namespace wyvern::detail;
+
+namespace {
+
+  // SAX handler building an `InternedTarget` directly from a target reply file.
+  // We only keep:
+  //  - name
+  //  - compileGroups[].{language, compileCommandFragments[].fragment, defines[].define, includes[].path}
+  //  - link.commandFragments[].{fragment, role}
+  // Any other object or array is skipped as a whole, without storing anything.
+  // Values are kept in the order given by CMake, which matters for linking.
+  class TargetReplyReader
+  {
+    enum class scope
+    {
+      target,
+      compile_groups,
+      compile_group,
+      compile_fragments,
+      compile_fragment,
+      defines,
+      define,
+      includes,
+      include,
+      link,
+      link_fragments,
+      link_fragment,
+    };
+
+    InternedTarget& target;
+    SymbolTable& symbols;
+    std::vector<scope> scopes;
+    std::size_t skipped_depth = 0; // > 0 while inside an object or array we don't need.
+    std::string current_key;
+
+    Symbol language = 0;
+    InternedCompilation compilation;
+    std::string fragment;
+    std::string role;
+
+    auto enter_object() -> std::optional<scope>
+    {
+      if(scopes.empty())
+        return scope::target;
+
+      switch(scopes.back())
+      {
+        case scope::target:             if(current_key == "link") return scope::link; break;
+        case scope::compile_groups:     return scope::compile_group;
+        case scope::compile_fragments:  return scope::compile_fragment;
+        case scope::defines:            return scope::define;
+        case scope::includes:           return scope::include;
+        case scope::link_fragments:     return scope::link_fragment;
+        default: break;
+      }
+      return {};
+    }
+
+    auto enter_array() -> std::optional<scope>
+    {
+      if(scopes.empty())
+        return {};
+
+      switch(scopes.back())
+      {
+        case scope::target:
+          if(current_key == "compileGroups") return scope::compile_groups;
+          break;
+        case scope::compile_group:
+          if(current_key == "compileCommandFragments") return scope::compile_fragments;
+          if(current_key == "defines") return scope::defines;
+          if(current_key == "includes") return scope::includes;
+          break;
+        case scope::link:
+          if(current_key == "commandFragments") return scope::link_fragments;
+          break;
+        default: break;
+      }
+      return {};
+    }
+
+    auto enter(std::optional<scope> entered) -> bool
+    {
+      if(skipped_depth > 0 || !entered)
+      {
+        ++skipped_depth;
+        return true;
+      }
+
+      if(entered == scope::compile_group)
+      {
+        language = symbols.intern("");
+        compilation = InternedCompilation{ symbols.memory() };
+      }
+      else if(entered == scope::link_fragment)
+      {
+        fragment.clear();
+        role.clear();
+      }
+
+      scopes.push_back(*entered);
+      return true;
+    }
+
+    auto leave() -> bool
+    {
+      if(skipped_depth > 0)
+      {
+        --skipped_depth;
+        return true;
+      }
+
+      const auto left = scopes.back();
+      scopes.pop_back();
+      switch(left)
+      {
+        case scope::compile_group:
+        {
+          target.language_compilation[language] = std::move(compilation);
+          break;
+        }
+        case scope::link_fragment:
+        {
+          if(role == "flags")
+          {
+            symbols.intern(parse_values(fragment), target.link_flags);
+          }
+          else if(role == "libraries")
+          {
+            symbols.intern(parse_values(fragment), target.link_libraries);
+          } // TODO: for some reason there is no library directories, the paths to the libraries is always complete?
+          else
+          {
+            throw failure(format("failed to read link info (unknown role): {}", role));
+          }
+          break;
+        }
+        default: break;
+      }
+      return true;
+    }
+
+  public:
+
+    TargetReplyReader(InternedTarget& target, SymbolTable& symbols) : target(target), symbols(symbols), compilation(symbols.memory()) {}
+
+    // nlohmann::json SAX interface
+
+    bool null() { return true; }
+    bool boolean(bool) { return true; }
+    bool number_integer(json::number_integer_t) { return true; }
+    bool number_unsigned(json::number_unsigned_t) { return true; }
+    bool number_float(json::number_float_t, const json::string_t&) { return true; }
+    template<class Binary>
+    bool binary(Binary&) { return true; }
+
+    bool string(json::string_t& value)
+    {
+      if(skipped_depth > 0 || scopes.empty())
+        return true;
+
+      switch(scopes.back())
+      {
+        case scope::target:           if(current_key == "name") target.name = value; break;
+        case scope::compile_group:    if(current_key == "language") language = symbols.intern(value); break;
+        case scope::compile_fragment: if(current_key == "fragment") symbols.intern(parse_values(value), compilation.compilation_flags); break;
+        case scope::define:           if(current_key == "define") compilation.defines.push_back(symbols.intern(value)); break;
+        case scope::include:          if(current_key == "path") compilation.include_directories.push_back(symbols.intern(value)); break; // TODO: decide if we need to keep isSystem
+        case scope::link_fragment:
+          if(current_key == "fragment") fragment = value;
+          else if(current_key == "role") role = value;
+          break;
+        default: break;
+      }
+      return true;
+    }
+
+    bool key(json::string_t& key)
+    {
+      if(skipped_depth == 0)
+        current_key = key;
+      return true;
+    }
+
+    bool start_object(std::size_t) { return enter(skipped_depth > 0 ? std::nullopt : enter_object()); }
+    bool end_object() { return leave(); }
+    bool start_array(std::size_t) { return enter(skipped_depth > 0 ? std::nullopt : enter_array()); }
+    bool end_array() { return leave(); }
+
+    template<class Exception>
+    bool parse_error(std::size_t position, const std::string& token, const Exception& error)
+    {
+      throw failure(format("invalid json at {} (near '{}'): {}", position, token, error.what()));
+    }
+  };
+
+  auto read_target_reply_content(std::string_view content, SymbolTable& symbols) -> InternedTarget
+  {
+    InternedTarget target{ symbols.memory() };
+    TargetReplyReader reader{ target, symbols };
+    json::sax_parse(content.begin(), content.end(), &reader);
+    return target;
+  }
+
+  // The target replies read by one thread: their values are interned in the thread's own table, allocated from
+  // its own arena, so that the threads never wait for each other. They are interned in the shared table afterwards.
+  struct WorkerReplies
+  {
+    static constexpr auto not_shared = std::numeric_limits<Symbol>::max(); // Never a symbol, see `SymbolTable::intern()`.
+
+    std::pmr::monotonic_buffer_resource arena;
+    SymbolTable symbols{ &arena };
+    std::pmr::vector<InternedTarget> targets{ &arena };
+    std::vector<Symbol> shared_symbols; // By symbol of the worker's table, `not_shared` until interned in the shared table.
+
+    auto shared(Symbol symbol, SymbolTable& shared_table) -> Symbol
+    {
+      if(shared_symbols.size() <= symbol)
+        shared_symbols.resize(symbols.size(), not_shared);
+      auto& shared_symbol = shared_symbols[symbol];
+      if(shared_symbol == not_shared)
+        shared_symbol = shared_table.intern(symbols.string(symbol));
+      return shared_symbol;
+    }
+
+    auto shared(const Symbols& values, SymbolTable& shared_table) -> Symbols
+    {
+      Symbols shared_values{ shared_table.memory() };
+      shared_values.reserve(values.size());
+      for(const auto symbol : values)
+        shared_values.push_back(shared(symbol, shared_table));
+      return shared_values;
+    }
+
+    // The target with the values interned in the shared table, allocated from its memory.
+    auto shared(const InternedTarget& target, SymbolTable& shared_table) -> InternedTarget
+    {
+      InternedTarget shared_target{ shared_table.memory() };
+      shared_target.name = target.name;
+      for(const auto& [language, compilation] : target.language_compilation)
+      {
+        auto& shared_compilation = shared_target.language_compilation[shared(language, shared_table)];
+        shared_compilation.include_directories = shared(compilation.include_directories, shared_table);
+        shared_compilation.compilation_flags = shared(compilation.compilation_flags, shared_table);
+        shared_compilation.defines = shared(compilation.defines, shared_table);
+        shared_compilation.source_files = shared(compilation.source_files, shared_table);
+      }
+      shared_target.libraries_directories = shared(target.libraries_directories, shared_table);
+      shared_target.link_flags = shared(target.link_flags, shared_table);
+      shared_target.link_libraries = shared(target.link_libraries, shared_table);
+      return shared_target;
+    }
+  };
+
+  auto find_index_file_path(dir_path reply_dir)
+  {
+    // Older indexes can be left in a reused build directory: as the file-api specifies, the current one
+    // is the lexicographically greatest.
+    path found_path;
+    butl::path_search(path("index-*.json"), [&](path path, const std::string&, bool){
+      if(found_path.empty() || found_path.string() < path.string())
+        found_path = path;
+      return true;
+    }, reply_dir);
+
+    if(found_path.empty())
+      throw failure(format("Failed to find index json file in {}", reply_dir.normalize(true, true).string()));
+    return (reply_dir / found_path).normalize(true, true);
+  }
+
+  // The reply to wyvern's query for that kind of object, from the index.
+  auto find_reply_path(dir_path reply_dir, const json& index, std::string_view kind) -> path
+  {
+    const auto& responses = index["reply"]["client-wyvern"]["query.json"]["responses"];
+    for(const auto& response : responses)
+    {
+      if(response["kind"] == kind)
+        return reply_dir / path(response["jsonFile"].get<std::string>());
+    }
+    throw failure(format("Failed to find {} reply in {}", kind, reply_dir.normalize(true, true).string()));
+  }
+
+  // The files CMake used to configure, we only keep the ones external to both CMake and the project.
+  auto read_external_files(const path& cmakefiles_reply_path) -> std::vector<path>
+  {
+    std::vector<path> external_files;
+    const auto cmakefiles_info = read_json_file(cmakefiles_reply_path);
+    for(const auto& input : cmakefiles_info["inputs"])
+    {
+      const bool is_external = input.value("isExternal", false);
+      const bool is_cmake = input.value("isCMake", false);
+      if(is_external && !is_cmake)
+        external_files.push_back(path(input["path"].get<std::string>()));
+    }
+    return external_files;
+  }
+
+}
+
+  auto read_target_reply(const path& target_reply_path, SymbolTable& symbols) -> InternedTarget
+  {
+    const MappedFile file{ target_reply_path };
+    return read_target_reply_content(file.content(), symbols);
+  }
+
+  auto read_cmake_api_reply_json(dir_path reply_dir, SymbolTable& symbols, unsigned max_jobs)
+    -> CodeModel
+  {
+    TraceSpan span{ "read_cmake_api_reply_json" };
+    CodeModel codemodel;
+    // 1. read the index to find the right codemodel file
+    const auto index_path = find_index_file_path(reply_dir);
+    const auto index = read_json_file(index_path);
+    log_lazily(LogLevel::debug, [&]{ return format("INDEX : {}", index.dump()); });
+
+    // 2. find the reply files for each of our requests.
+    // 2.a read the codemodel file to find the right target files
+    const auto codemodel_path = find_reply_path(reply_dir, index, "codemodel");
+    log(LogLevel::debug, "CodeModel file : {}", codemodel_path.string());
+    const auto codemodel_info = read_json_file(codemodel_path);
+
+    // 2.b read the list of files CMake used to configure.
+    codemodel.external_files = read_external_files(find_reply_path(reply_dir, index, "cmakeFiles"));
+
+    // 3. gather information about each target, reading the target files concurrently.
+    struct TargetReply
+    {
+      std::string config_name;
+      std::string target_name;
+      path reply_path;
+    };
+    std::vector<TargetReply> target_replies;
+    for(const auto& config : codemodel_info["configurations"])
+    {
+      const std::string config_name = config["name"];
+      codemodel.configs.try_emplace(config_name, symbols.memory()).first->second.name = config_name;
+      for(const auto& target : config["targets"])
+      {
+        const std::string target_name = target["name"];
+        if(target_name == "ALL_BUILD" || target_name == "ZERO_CHECK") // Skip targets generated by CMake for convenience.
+          continue;
+
+        const std::string target_file = target["jsonFile"];
+        target_replies.push_back({ config_name, target_name, reply_dir / path(target_file) });
+      }
+    }
+
+    const auto jobs = std::min<std::size_t>(target_replies.size(), max_jobs == 0 ? std::max(1u, std::thread::hardware_concurrency()) : max_jobs);
+    std::atomic<std::size_t> bytes_read{ 0 };
+    const auto insert_target = [&](const TargetReply& reply, InternedTarget target){
+      auto& config_targets = codemodel.configs.at(reply.config_name).targets;
+      config_targets.insert_or_assign(std::pmr::string{ reply.target_name, symbols.memory() }, std::move(target));
+    };
+
+    if(jobs <= 1)
+    {
+      for(const auto& reply : target_replies)
+      {
+        const MappedFile file{ reply.reply_path };
+        bytes_read += file.content().size();
+        insert_target(reply, read_target_reply_content(file.content(), symbols));
+      }
+    }
+    else
+    {
+      // Each thread takes the next file to read, into its own table.
+      struct TargetLocation
+      {
+        std::size_t worker_index;
+        std::size_t target_index; // In the worker's targets.
+      };
+      std::vector<std::unique_ptr<WorkerReplies>> workers(jobs);
+      std::vector<TargetLocation> locations(target_replies.size());
+      std::atomic<std::size_t> next_index{ 0 };
+      for_each_index_concurrently(workers.size(), static_cast<unsigned>(workers.size()), [&](std::size_t worker_index){
+        auto& worker = *(workers[worker_index] = std::make_unique<WorkerReplies>());
+        for(auto index = next_index++; index < target_replies.size(); index = next_index++)
+        {
+          const MappedFile file{ target_replies[index].reply_path };
+          bytes_read += file.content().size();
+          worker.targets.push_back(read_target_reply_content(file.content(), worker.symbols));
+          locations[index] = { worker_index, worker.targets.size() - 1 };
+        }
+      });
+
+      // Merged in the order of the codemodel, whatever the order in which the files were read:
+      // the shared table is the same as if they were read by one thread.
+      for(std::size_t index = 0; index < target_replies.size(); ++index)
+      {
+        auto& worker = *workers[locations[index].worker_index];
+        insert_target(target_replies[index], worker.shared(worker.targets[locations[index].target_index], symbols));
+      }
+    }
+    span.arg("configurations", codemodel.configs.size())
+        .arg("targets", target_replies.size())
+        .arg("target_reply_bytes", bytes_read.load())
+        .arg("jobs", jobs);
+    return codemodel;
+  }
+
+  auto read_cmake_files_reply(dir_path reply_dir) -> std::vector<path>
+  {
+    const auto index = read_json_file(find_index_file_path(reply_dir));
+    return read_external_files(find_reply_path(reply_dir, index, "cmakeFiles"));
+  }
+
+}
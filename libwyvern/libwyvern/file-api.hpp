@@ -0,0 +1,39 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <libbutl/path.mxx>
+
+#include <libwyvern/wyvern.hpp>
+#include <libwyvern/symbols.hpp>
+#include <libwyvern/export.hpp>
+
+namespace wyvern::cmake {
+
+  // Information from the replies of CMake's file-api to wyvern's query (see `client-wyvern`).
+  struct CodeModel
+  {
+    std::map<std::string, detail::InternedConfiguration> configs; // Compilation and link information of each target, per configuration.
+    std::vector<path> external_files; // Files read by CMake while configuring which are not part of CMake nor the project (package config files for example).
+  };
+
+  // Reads the replies found in a build directory's `.cmake/api/v1/reply/` directory.
+  // Target reply files are read concurrently by at most `max_jobs` threads (hardware concurrency if 0),
+  // each interning in a table of its own, merged in `symbols` in the order of the codemodel:
+  // the result does not depend on it.
+  // The values are interned in `symbols`, the configurations are allocated from its memory.
+  LIBWYVERN_SYMEXPORT
+  auto read_cmake_api_reply_json(dir_path reply_dir, detail::SymbolTable& symbols, unsigned max_jobs = 0) -> CodeModel;
+
+  // Only reads the cmakeFiles reply, for the queries without codemodel: the files read by CMake (see `CodeModel::external_files`).
+  LIBWYVERN_SYMEXPORT
+  auto read_cmake_files_reply(dir_path reply_dir) -> std::vector<path>;
+
+  // Reads a codemodel target reply file (`target-*.json`), keeping only the compilation and link information.
+  // The file is streamed: the other parts (sources, backtraces, artifacts...) are skipped without being stored.
+  LIBWYVERN_SYMEXPORT
+  auto read_target_reply(const path& target_reply_path, detail::SymbolTable& symbols) -> detail::InternedTarget;
+
+}
@@ -0,0 +1,170 @@
+#include <libwyvern/process-output.hpp>
+#include <libwyvern/context.hpp>
+
+#include <thread>
+#include <condition_variable>
+
+namespace wyvern::detail {
+
+  auto RingBuffer::append(std::string_view text) -> void
+  {
+    appended += text.size();
+    if(capacity == 0)
+      return;
+
+    if(text.size() >= capacity)
+    {
+      data.assign(text.substr(text.size() - capacity));
+      begin = 0;
+      return;
+    }
+
+    if(data.size() < capacity) // Not full yet.
+    {
+      const auto count = std::min(capacity - data.size(), text.size());
+      data.append(text.substr(0, count));
+      text.remove_prefix(count);
+    }
+
+    while(!text.empty()) // Overwrite the oldest bytes.
+    {
+      const auto count = std::min(capacity - begin, text.size());
+      data.replace(begin, count, text.substr(0, count));
+      begin = (begin + count) % capacity;
+      text.remove_prefix(count);
+    }
+  }
+
+  auto RingBuffer::content() const -> std::string
+  {
+    auto oldest = data.substr(begin);
+    oldest.append(data, 0, begin);
+    return oldest;
+  }
+
+  struct OutputCapture::State
+  {
+    std::mutex mutex;
+    std::condition_variable changed;
+    RingBuffer tail;
+    const LineHandler handler;
+    const LineConsumer consumer;
+    CallContext* const context; // Of the call which started the process, to log the lines. Not used once abandoned.
+    int open_streams = 0;
+    bool is_abandoned = false;
+
+    State(std::size_t tail_size, LineHandler handler, LineConsumer consumer)
+      : tail(tail_size)
+      , handler(std::move(handler))
+      , consumer(std::move(consumer))
+      , context(current_context())
+    {}
+
+    auto add_line(std::string_view line) -> void
+    {
+      const std::lock_guard<std::mutex> lock{ mutex }; // Also keeps the lines of both streams whole.
+      if(is_abandoned)
+        return;
+
+      if(consumer)
+      {
+        try
+        {
+          if(consumer(line))
+            return;
+        }
+        catch(...)
+        {
+          // Kept as any other line.
+        }
+      }
+
+      tail.append(line);
+      tail.append("\n");
+
+      if(handler)
+      {
+        try
+        {
+          handler(line);
+        }
+        catch(...)
+        {
+          // The reading must go on, or the process would block.
+        }
+      }
+
+      log(LogLevel::debug, "[cmake] {}", line);
+    }
+
+    static auto read_lines(std::shared_ptr<State> state, butl::auto_fd fd) -> void
+    {
+      const ScopedContext scoped_context{ state->context };
+      try
+      {
+        butl::ifdstream stream{ std::move(fd), butl::fdstream_mode::close, std::ios_base::badbit };
+        std::string line;
+        while(std::getline(stream, line))
+        {
+          if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+          state->add_line(line);
+        }
+      }
+      catch(const std::exception&)
+      {
+        // The pipe is broken: nothing more to read.
+      }
+
+      {
+        const std::lock_guard<std::mutex> lock{ state->mutex };
+        --state->open_streams;
+      }
+      state->changed.notify_all();
+    }
+  };
+
+  OutputCapture::OutputCapture(std::size_t tail_size, LineHandler handler, LineConsumer consumer)
+    : state(std::make_shared<State>(tail_size, std::move(handler), std::move(consumer)))
+  {
+  }
+
+  OutputCapture::~OutputCapture()
+  {
+    const std::lock_guard<std::mutex> lock{ state->mutex };
+    state->is_abandoned = true;
+  }
+
+  auto OutputCapture::start(butl::auto_fd&& output, butl::auto_fd&& error) -> void
+  {
+    for(auto* fd : { &output, &error })
+    {
+      {
+        const std::lock_guard<std::mutex> lock{ state->mutex };
+        ++state->open_streams;
+      }
+      // Detached: they end with the pipes, which can be after the capture (see `finish()`).
+      std::thread{ State::read_lines, state, std::move(*fd) }.detach();
+    }
+  }
+
+  auto OutputCapture::finish(std::chrono::milliseconds grace_period) -> void
+  {
+    std::unique_lock<std::mutex> lock{ state->mutex };
+    state->changed.wait_for(lock, grace_period, [&]{ return state->open_streams == 0; });
+    state->is_abandoned = true;
+  }
+
+  auto OutputCapture::tail() const -> std::string
+  {
+    const std::lock_guard<std::mutex> lock{ state->mutex };
+    return state->tail.content();
+  }
+
+  auto OutputCapture::size() const -> std::size_t
+  {
+    const std::lock_guard<std::mutex> lock{ state->mutex };
+    return state->tail.size();
+  }
+
+}
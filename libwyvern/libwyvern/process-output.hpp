@@ -0,0 +1,71 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <functional>
+
+#include <libbutl/fdstream.mxx>
+
+#include <libwyvern/utility.hpp>
+#include <libwyvern/export.hpp>
+
+namespace wyvern::detail {
+
+  // Keeps the last `capacity` bytes appended to it.
+  class LIBWYVERN_SYMEXPORT RingBuffer
+  {
+    std::string data;
+    std::size_t begin = 0; // Of the oldest byte, once full.
+    std::size_t capacity;
+    std::size_t appended = 0;
+
+  public:
+    explicit RingBuffer(std::size_t capacity) : capacity(capacity) {}
+
+    auto append(std::string_view text) -> void;
+
+    // What was kept, from the oldest to the newest byte.
+    auto content() const -> std::string;
+
+    // All the bytes appended, even the ones not kept anymore.
+    auto size() const -> std::size_t { return appended; }
+  };
+
+  // Reads a child process' standard output and error as soon as they are written, in other threads,
+  // so that it never blocks on a full pipe. The latest lines are kept in a ring buffer, and each line
+  // is passed to the handler and logged (debug level) in the context of the call which started the process.
+  // The lines a consumer takes (CMake's trace, see `TraceReader`) are only passed to it: however many, they are never buffered.
+  class LIBWYVERN_SYMEXPORT OutputCapture
+  {
+    struct State;
+    std::shared_ptr<State> state; // Shared with the reading threads, which can outlive the capture (see `finish()`).
+
+  public:
+    using LineHandler = std::function<void(std::string_view line)>;
+
+    // Returns true if it takes the line. Called for each line in the order they are read, one at a time, until `finish()`.
+    using LineConsumer = std::function<bool(std::string_view line)>;
+
+    OutputCapture(std::size_t tail_size, LineHandler handler, LineConsumer consumer = nullptr);
+    ~OutputCapture(); // Stops handling lines without waiting.
+    OutputCapture(const OutputCapture&) = delete;
+    OutputCapture& operator=(const OutputCapture&) = delete;
+
+    // Starts reading from both pipes until they are closed.
+    auto start(butl::auto_fd&& output, butl::auto_fd&& error) -> void;
+
+    // Waits for both pipes to be closed, at most `grace_period` as they can be kept open by processes
+    // the child started (compiler servers for example). Lines read after that are ignored.
+    auto finish(std::chrono::milliseconds grace_period) -> void;
+
+    // Latest output, lines of both pipes in the order they were read.
+    auto tail() const -> std::string;
+
+    // Size of the output read.
+    auto size() const -> std::size_t;
+  };
+
+}
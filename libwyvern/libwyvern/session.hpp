@@ -0,0 +1,58 @@
+#pragma once
+
+#include <mutex>
+#include <cstddef>
+#include <memory_resource>
+
+#include <libwyvern/symbols.hpp>
+
+namespace wyvern::detail {
+
+  // Serializes the allocations made from another memory resource.
+  class LockedResource : public std::pmr::memory_resource
+  {
+    std::mutex mutex;
+    std::pmr::memory_resource& upstream;
+
+    auto do_allocate(std::size_t bytes, std::size_t alignment) -> void* override
+    {
+      const std::lock_guard<std::mutex> lock{ mutex };
+      return upstream.allocate(bytes, alignment);
+    }
+
+    auto do_deallocate(void* pointer, std::size_t bytes, std::size_t alignment) -> void override
+    {
+      const std::lock_guard<std::mutex> lock{ mutex };
+      upstream.deallocate(pointer, bytes, alignment);
+    }
+
+    auto do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool override
+    {
+      return this == &other;
+    }
+
+  public:
+    explicit LockedResource(std::pmr::memory_resource& upstream) : upstream(upstream) {}
+  };
+
+  // State of one extraction: what is read from CMake's replies and compared is allocated
+  // from an arena released all at once at the end of the session, only the results are copied out.
+  // The control and dependent projects' replies are read concurrently, so the arena is locked.
+  class ExtractionSession
+  {
+    static constexpr std::size_t initial_arena_size = 64 * 1024;
+
+    std::pmr::monotonic_buffer_resource arena{ initial_arena_size };
+    LockedResource locked_arena{ arena };
+
+  public:
+    SymbolTable symbols{ &locked_arena };
+
+    ExtractionSession() = default;
+    ExtractionSession(const ExtractionSession&) = delete;
+    ExtractionSession& operator=(const ExtractionSession&) = delete;
+
+    auto memory() -> std::pmr::memory_resource* { return &locked_arena; }
+  };
+
+}
@@ -0,0 +1,117 @@
+#include <libwyvern/symbols.hpp>
+
+#include <limits>
+#include <algorithm>
+
+#include <libwyvern/utility.hpp>
+
+namespace wyvern::detail {
+
+  SymbolTable::SymbolTable(std::pmr::memory_resource* memory)
+    : memory_resource(memory), strings(memory), symbols(memory)
+  {
+  }
+
+  auto SymbolTable::intern(std::string_view value) -> Symbol
+  {
+    const std::lock_guard<std::mutex> lock{ mutex };
+    const auto found = symbols.find(value);
+    if(found != symbols.end())
+      return found->second;
+
+    if(strings.size() == std::numeric_limits<Symbol>::max())
+      throw failure("Too many distinct strings to intern");
+
+    // Never deallocated: the memory is expected to be released all at once with the table.
+    auto characters = static_cast<char*>(memory_resource->allocate(value.size(), alignof(char)));
+    std::copy(value.begin(), value.end(), characters);
+    const std::string_view stored{ characters, value.size() };
+
+    const auto symbol = static_cast<Symbol>(strings.size());
+    strings.push_back(stored);
+    symbols.emplace(stored, symbol);
+    return symbol;
+  }
+
+  auto SymbolTable::intern(const std::vector<std::string>& values) -> Symbols
+  {
+    Symbols interned{ memory_resource };
+    intern(values, interned);
+    return interned;
+  }
+
+  auto SymbolTable::intern(const std::vector<std::string>& values, Symbols& interned) -> void
+  {
+    interned.reserve(interned.size() + values.size());
+    for(const auto& value : values)
+      interned.push_back(intern(value));
+  }
+
+  auto SymbolTable::string(Symbol symbol) const -> std::string_view
+  {
+    const std::lock_guard<std::mutex> lock{ mutex };
+    return strings.at(symbol);
+  }
+
+  auto SymbolTable::strings_of(const Symbols& values) const -> std::vector<std::string>
+  {
+    const std::lock_guard<std::mutex> lock{ mutex };
+    std::vector<std::string> result;
+    result.reserve(values.size());
+    for(const auto symbol : values)
+      result.emplace_back(strings.at(symbol));
+    return result;
+  }
+
+  auto SymbolTable::size() const -> std::size_t
+  {
+    const std::lock_guard<std::mutex> lock{ mutex };
+    return strings.size();
+  }
+
+  auto intern(const Target& target, SymbolTable& symbols) -> InternedTarget
+  {
+    InternedTarget interned{ symbols.memory() };
+    interned.name = target.name;
+    for(const auto& [language, compilation] : target.language_compilation)
+    {
+      auto& interned_compilation = interned.language_compilation[symbols.intern(language)];
+      interned_compilation.include_directories = symbols.intern(compilation.include_directories);
+      interned_compilation.compilation_flags = symbols.intern(compilation.compilation_flags);
+      interned_compilation.defines = symbols.intern(compilation.defines);
+      interned_compilation.source_files = symbols.intern(compilation.source_files);
+    }
+    interned.libraries_directories = symbols.intern(target.libraries_directories);
+    interned.link_flags = symbols.intern(target.link_flags);
+    interned.link_libraries = symbols.intern(target.link_libraries);
+    return interned;
+  }
+
+  auto to_target(const InternedTarget& interned, const SymbolTable& symbols) -> Target
+  {
+    Target target;
+    target.name = std::string(interned.name);
+    for(const auto& [language, interned_compilation] : interned.language_compilation)
+    {
+      auto& compilation = target.language_compilation[std::string(symbols.string(language))];
+      compilation.include_directories = symbols.strings_of(interned_compilation.include_directories);
+      compilation.compilation_flags = symbols.strings_of(interned_compilation.compilation_flags);
+      compilation.defines = symbols.strings_of(interned_compilation.defines);
+      compilation.source_files = symbols.strings_of(interned_compilation.source_files);
+    }
+    target.libraries_directories = symbols.strings_of(interned.libraries_directories);
+    target.link_flags = symbols.strings_of(interned.link_flags);
+    target.link_libraries = symbols.strings_of(interned.link_libraries);
+    return target;
+  }
+
+  auto to_configuration(const InternedConfiguration& interned, const SymbolTable& symbols) -> Configuration
+  {
+    Configuration config;
+    config.name = std::string(interned.name);
+    for(const auto& [target_name, target] : interned.targets)
+      config.targets[std::string(target_name)] = to_target(target, symbols);
+    return config;
+  }
+
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+#include <unordered_map>
+#include <memory_resource>
+
+#include <libwyvern/wyvern.hpp>
+#include <libwyvern/export.hpp>
+
+namespace wyvern::detail {
+
+  using Symbol = std::uint32_t;
+  using Symbols = std::pmr::vector<Symbol>;
+
+  // Pool of the strings read from CMake's replies: each distinct string is stored once and
+  // identified by its Symbol, so the same flag or path used by many targets costs 4 bytes per use
+  // and values are compared as integers. Thread-safe, the control and dependent projects are read concurrently.
+  // Everything is allocated from `memory`, which must also be thread-safe and outlive the table.
+  class LIBWYVERN_SYMEXPORT SymbolTable
+  {
+    std::pmr::memory_resource* memory_resource;
+    mutable std::mutex mutex;
+    std::pmr::vector<std::string_view> strings; // Indexed by symbol, their characters are allocated from `memory`.
+    std::pmr::unordered_map<std::string_view, Symbol> symbols;
+
+  public:
+    explicit SymbolTable(std::pmr::memory_resource* memory = std::pmr::get_default_resource());
+    SymbolTable(const SymbolTable&) = delete;
+    SymbolTable& operator=(const SymbolTable&) = delete;
+
+    auto intern(std::string_view value) -> Symbol;
+    auto intern(const std::vector<std::string>& values) -> Symbols;
+    auto intern(const std::vector<std::string>& values, Symbols& interned) -> void; // Appends to `interned`.
+
+    auto string(Symbol symbol) const -> std::string_view;
+    auto strings_of(const Symbols& values) const -> std::vector<std::string>;
+
+    auto size() const -> std::size_t;
+    auto memory() const -> std::pmr::memory_resource* { return memory_resource; }
+  };
+
+  // Same as `Compilation`, `Target` and `Configuration`, with interned values.
+  // The public types are only built from these for the results.
+  // They are allocator-aware, so that containers of them propagate their memory resource.
+
+  struct InternedCompilation
+  {
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    Symbols include_directories;
+    Symbols compilation_flags;
+    Symbols defines;
+    Symbols source_files;
+
+    explicit InternedCompilation(allocator_type allocator = {})
+      : include_directories(allocator), compilation_flags(allocator), defines(allocator), source_files(allocator) {}
+    InternedCompilation(const InternedCompilation& other, allocator_type allocator)
+      : include_directories(other.include_directories, allocator), compilation_flags(other.compilation_flags, allocator)
+      , defines(other.defines, allocator), source_files(other.source_files, allocator) {}
+    InternedCompilation(InternedCompilation&& other, allocator_type allocator)
+      : include_directories(std::move(other.include_directories), allocator), compilation_flags(std::move(other.compilation_flags), allocator)
+      , defines(std::move(other.defines), allocator), source_files(std::move(other.source_files), allocator) {}
+    InternedCompilation(const InternedCompilation&) = default;
+    InternedCompilation(InternedCompilation&&) = default;
+    InternedCompilation& operator=(const InternedCompilation&) = default;
+    InternedCompilation& operator=(InternedCompilation&&) = default;
+  };
+
+  struct InternedTarget
+  {
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    std::pmr::string name;
+    std::pmr::map<Symbol, InternedCompilation> language_compilation;
+    Symbols libraries_directories;
+    Symbols link_flags;
+    Symbols link_libraries;
+
+    explicit InternedTarget(allocator_type allocator = {})
+      : name(allocator), language_compilation(allocator), libraries_directories(allocator), link_flags(allocator), link_libraries(allocator) {}
+    InternedTarget(const InternedTarget& other, allocator_type allocator)
+      : name(other.name, allocator), language_compilation(other.language_compilation, allocator)
+      , libraries_directories(other.libraries_directories, allocator), link_flags(other.link_flags, allocator), link_libraries(other.link_libraries, allocator) {}
+    InternedTarget(InternedTarget&& other, allocator_type allocator)
+      : name(std::move(other.name), allocator), language_compilation(std::move(other.language_compilation), allocator)
+      , libraries_directories(std::move(other.libraries_directories), allocator), link_flags(std::move(other.link_flags), allocator)
+      , link_libraries(std::move(other.link_libraries), allocator) {}
+    InternedTarget(const InternedTarget&) = default;
+    InternedTarget(InternedTarget&&) = default;
+    InternedTarget& operator=(const InternedTarget&) = default;
+    InternedTarget& operator=(InternedTarget&&) = default;
+  };
+
+  struct InternedConfiguration
+  {
+    using allocator_type = std::pmr::polymorphic_allocator<std::byte>;
+
+    std::pmr::string name;
+    std::pmr::map<std::pmr::string, InternedTarget> targets;
+
+    explicit InternedConfiguration(allocator_type allocator = {})
+      : name(allocator), targets(allocator) {}
+    InternedConfiguration(const InternedConfiguration& other, allocator_type allocator)
+      : name(other.name, allocator), targets(other.targets, allocator) {}
+    InternedConfiguration(InternedConfiguration&& other, allocator_type allocator)
+      : name(std::move(other.name), allocator), targets(std::move(other.targets), allocator) {}
+    InternedConfiguration(const InternedConfiguration&) = default;
+    InternedConfiguration(InternedConfiguration&&) = default;
+    InternedConfiguration& operator=(const InternedConfiguration&) = default;
+    InternedConfiguration& operator=(InternedConfiguration&&) = default;
+  };
+
+  // Interned values are allocated from the table's memory.
+  LIBWYVERN_SYMEXPORT
+  auto intern(const Target& target, SymbolTable& symbols) -> InternedTarget;
+
+  LIBWYVERN_SYMEXPORT
+  auto to_target(const InternedTarget& target, const SymbolTable& symbols) -> Target;
+
+  LIBWYVERN_SYMEXPORT
+  auto to_configuration(const InternedConfiguration& config, const SymbolTable& symbols) -> Configuration;
+
+}
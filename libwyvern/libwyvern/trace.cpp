@@ -0,0 +1,80 @@
+#include <libwyvern/trace.hpp>
+#include <libwyvern/context.hpp>
+
+#include <algorithm>
+
+namespace wyvern::detail {
+namespace {
+
+  template<class Duration>
+  auto to_microseconds(Duration duration) -> double
+  {
+    return std::chrono::duration<double, std::micro>(duration).count();
+  }
+
+  constexpr auto trace_process_id = 1;
+
+}
+
+  auto Tracer::record(std::string name, clock::time_point start, clock::time_point end, json args) -> void
+  {
+    const auto thread_id = std::this_thread::get_id();
+    const std::lock_guard<std::mutex> lock{ mutex };
+    auto thread = std::find(threads.begin(), threads.end(), thread_id);
+    if(thread == threads.end())
+      thread = threads.insert(threads.end(), thread_id);
+    const auto thread_index = static_cast<std::size_t>(thread - threads.begin());
+    events.push_back({ std::move(name), start, end - start, thread_index, std::move(args) });
+  }
+
+  auto Tracer::to_json() -> json
+  {
+    const std::lock_guard<std::mutex> lock{ mutex };
+    json trace_events = json::array();
+    trace_events.push_back({ { "name", "process_name" }, { "ph", "M" }, { "pid", trace_process_id }, { "args", { { "name", "wyvern" } } } });
+    for(std::size_t thread_index = 0; thread_index < threads.size(); ++thread_index)
+    {
+      trace_events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", trace_process_id }, { "tid", thread_index },
+        { "args", { { "name", thread_index == 0 ? std::string("caller") : format("worker {}", thread_index) } } } });
+    }
+
+    // Complete events ("X"): a start and a duration, in microseconds.
+    for(const auto& event : events)
+    {
+      json trace_event = {
+        { "name", event.name },
+        { "cat", "wyvern" },
+        { "ph", "X" },
+        { "ts", to_microseconds(event.start - origin) },
+        { "dur", to_microseconds(event.duration) },
+        { "pid", trace_process_id },
+        { "tid", event.thread_index },
+      };
+      if(!event.args.is_null())
+        trace_event["args"] = event.args;
+      trace_events.push_back(std::move(trace_event));
+    }
+    return { { "traceEvents", std::move(trace_events) }, { "displayTimeUnit", "ms" } };
+  }
+
+  TraceSpan::TraceSpan(const char* name)
+    : tracer(current_context() ? current_context()->tracer.get() : nullptr), name(name), start(tracer ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point{})
+  {
+  }
+
+  TraceSpan::~TraceSpan()
+  {
+    if(!tracer)
+      return;
+
+    // Recording allocates: if it fails, the event is dropped rather than terminating the extraction.
+    try
+    {
+      tracer->record(name, start, std::chrono::steady_clock::now(), std::move(args));
+    }
+    catch(...)
+    {
+    }
+  }
+
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+
+#include <libwyvern/utility.hpp>
+#include <libwyvern/export.hpp>
+
+namespace wyvern::detail {
+
+  // Timing of the phases of an extraction, written as Chrome's trace-event JSON
+  // (loads in chrome://tracing or https://ui.perfetto.dev).
+  class LIBWYVERN_SYMEXPORT Tracer
+  {
+    using clock = std::chrono::steady_clock;
+
+    struct Event
+    {
+      std::string name;
+      clock::time_point start;
+      clock::duration duration;
+      std::size_t thread_index;
+      json args;
+    };
+
+    const clock::time_point origin = clock::now();
+    std::mutex mutex;
+    std::vector<Event> events;
+    std::vector<std::thread::id> threads; // Their index is the thread id in the trace, in order of appearance.
+
+  public:
+    Tracer() : threads{ std::this_thread::get_id() } {} // The recording thread comes first.
+
+    auto record(std::string name, clock::time_point start, clock::time_point end, json args) -> void;
+    auto to_json() -> json;
+  };
+
+  // Records the duration of a phase, from construction to destruction, if the current call is traced
+  // (see `Options::trace_file`).
+  // Arguments are attributes of the phase displayed with it (command, number of targets, bytes read...).
+  class LIBWYVERN_SYMEXPORT TraceSpan
+  {
+    Tracer* tracer;
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+    json args;
+
+  public:
+    explicit TraceSpan(const char* name);
+    ~TraceSpan();
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    template<class Value>
+    auto arg(const std::string& key, Value&& value) -> TraceSpan&
+    {
+      if(tracer)
+        args[key] = std::forward<Value>(value);
+      return *this;
+    }
+
+    // Whether the arguments are recorded, to avoid computing costly ones for nothing.
+    auto is_recording() const -> bool { return tracer != nullptr; }
+  };
+
+}
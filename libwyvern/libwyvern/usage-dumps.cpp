@@ -0,0 +1,424 @@
+#include <libwyvern/usage-dumps.hpp>
+
+#include <map>
+#include <set>
+#include <string_view>
+
+#include <libbutl/filesystem.mxx>
+
+#include <libwyvern/export-files.hpp>
+#include <libwyvern/trace.hpp>
+
+namespace wyvern::detail {
+namespace {
+
+  // Defines the functions the generated targets call, and clears the files of a previous generation.
+  // The closure of each dependency is found while configuring, following every target named in the link libraries
+  // whatever the conditions around them, then the files are generated with the conditions evaluated by CMake.
+  // Only the generator expressions which evaluate the same whichever target uses them are accepted: the others
+  // (`$<COMPILE_LANGUAGE>`...) could not be evaluated in these files, or not as when compiling.
+  constexpr auto usage_dumps_functions = R"cmake(
+# Usage requirements of the dependencies, evaluated when generating the build-system.
+set(wyvern_usage_directory "${CMAKE_BINARY_DIR}/wyvern-usage")
+file(REMOVE_RECURSE "${wyvern_usage_directory}")
+set_property(GLOBAL PROPERTY wyvern_usage_visited "")
+set_property(GLOBAL PROPERTY wyvern_usage_unsupported "")
+set_property(GLOBAL PROPERTY wyvern_usage_content "")
+
+set(wyvern_usage_expressions 0 1 BOOL AND OR NOT IF STREQUAL EQUAL IN_LIST VERSION_LESS VERSION_GREATER VERSION_EQUAL
+  VERSION_LESS_EQUAL VERSION_GREATER_EQUAL CONFIG PLATFORM_ID C_COMPILER_ID CXX_COMPILER_ID C_COMPILER_VERSION CXX_COMPILER_VERSION
+  TARGET_EXISTS TARGET_NAME_IF_EXISTS BUILD_INTERFACE INSTALL_INTERFACE LINK_ONLY ANGLE-R COMMA SEMICOLON)
+
+function(wyvern_usage_unsupported reason)
+  set_property(GLOBAL APPEND_STRING PROPERTY wyvern_usage_unsupported "${reason}\n")
+endfunction()
+
+function(wyvern_usage_property variable target property)
+  get_target_property(value "${target}" ${property})
+  if("${value}" MATCHES "-NOTFOUND$")
+    set(value "")
+  endif()
+  set(${variable} "${value}" PARENT_SCOPE)
+endfunction()
+
+function(wyvern_usage_visit target)
+  get_property(visited GLOBAL PROPERTY wyvern_usage_visited)
+  if(target IN_LIST visited)
+    return()
+  endif()
+  set_property(GLOBAL APPEND PROPERTY wyvern_usage_visited "${target}")
+
+  if(NOT TARGET "${target}")
+    wyvern_usage_unsupported("${target} is not a target")
+    return()
+  endif()
+  get_target_property(aliased "${target}" ALIASED_TARGET)
+  if(aliased)
+    set_property(GLOBAL APPEND_STRING PROPERTY wyvern_usage_content "alias\t${target}\t${aliased}\n")
+    wyvern_usage_visit("${aliased}")
+    return()
+  endif()
+  get_target_property(imported "${target}" IMPORTED)
+  if(NOT imported)
+    wyvern_usage_unsupported("${target} is not an imported target")
+    return()
+  endif()
+
+  # Properties changing the compilation or the link in ways the files don't tell.
+  get_target_property(type "${target}" TYPE)
+  set(checked_properties INTERFACE_POSITION_INDEPENDENT_CODE INTERFACE_PRECOMPILE_HEADERS)
+  if(type STREQUAL "INTERFACE_LIBRARY")
+    set(imported_properties IMPORTED_LIBNAME)
+  else()
+    set(imported_properties IMPORTED_LINK_INTERFACE_LANGUAGES IMPORTED_LINK_DEPENDENT_LIBRARIES IMPORTED_LINK_INTERFACE_LIBRARIES
+      IMPORTED_LINK_INTERFACE_MULTIPLICITY IMPORTED_NO_SONAME)
+  endif()
+  wyvern_usage_property(configurations "${target}" IMPORTED_CONFIGURATIONS)
+  foreach(property IN LISTS imported_properties)
+    list(APPEND checked_properties ${property})
+    foreach(configuration IN LISTS configurations)
+      string(TOUPPER "${configuration}" configuration)
+      list(APPEND checked_properties ${property}_${configuration})
+    endforeach()
+  endforeach()
+  foreach(property IN LISTS checked_properties)
+    wyvern_usage_property(value "${target}" ${property})
+    if(property MATCHES "^IMPORTED_LINK_INTERFACE_LANGUAGES")
+      foreach(language IN LISTS value)
+        if(NOT language STREQUAL "C" AND NOT language STREQUAL "CXX")
+          wyvern_usage_unsupported("${target} needs the ${language} linker")
+        endif()
+      endforeach()
+    elseif(value)
+      wyvern_usage_unsupported("${target} has the property ${property}")
+    endif()
+  endforeach()
+
+  foreach(property INTERFACE_INCLUDE_DIRECTORIES INTERFACE_SYSTEM_INCLUDE_DIRECTORIES INTERFACE_COMPILE_DEFINITIONS INTERFACE_COMPILE_OPTIONS
+                   INTERFACE_COMPILE_FEATURES INTERFACE_LINK_LIBRARIES INTERFACE_LINK_OPTIONS INTERFACE_LINK_DIRECTORIES)
+    wyvern_usage_property(value "${target}" ${property})
+    string(REGEX MATCHALL "\\$<[A-Za-z0-9_-]*" expressions "${value}")
+    foreach(expression IN LISTS expressions)
+      string(SUBSTRING "${expression}" 2 -1 expression)
+      if(NOT expression STREQUAL "" AND NOT expression IN_LIST wyvern_usage_expressions)
+        wyvern_usage_unsupported("property ${property} of ${target} uses $<${expression}>")
+      endif()
+    endforeach()
+  endforeach()
+
+  # The link libraries as CMake links them: `$<LINK_ONLY>` only matters to the compilation.
+  wyvern_usage_property(libraries "${target}" INTERFACE_LINK_LIBRARIES)
+  string(REPLACE "$<LINK_ONLY:" "$<1:" libraries "${libraries}")
+  set(linker_file "")
+  if(type STREQUAL "SHARED_LIBRARY" OR type STREQUAL "STATIC_LIBRARY")
+    set(linker_file "$<TARGET_LINKER_FILE:${target}>")
+  endif()
+  wyvern_usage_property(include_directories "${target}" INTERFACE_INCLUDE_DIRECTORIES)
+  wyvern_usage_property(definitions "${target}" INTERFACE_COMPILE_DEFINITIONS)
+  set_property(GLOBAL APPEND_STRING PROPERTY wyvern_usage_content
+    "target\t${target}\t${type}\t${linker_file}\t${libraries}\t${include_directories}\t${definitions}\n")
+
+  string(REGEX REPLACE "\\$<[A-Za-z0-9_-]*:?|>:?|," ";" items "${libraries}")
+  foreach(item IN LISTS items)
+    if(TARGET "${item}")
+      wyvern_usage_visit("${item}")
+    endif()
+  endforeach()
+endfunction()
+
+function(wyvern_usage_consumer consumer name dependency)
+  wyvern_usage_visit("${dependency}")
+  set(line "consumer\t${name}\t${dependency}")
+  foreach(property INCLUDE_DIRECTORIES COMPILE_DEFINITIONS COMPILE_OPTIONS COMPILE_FEATURES LINK_OPTIONS LINK_DIRECTORIES)
+    string(APPEND line "\t$<TARGET_PROPERTY:${consumer},${property}>")
+  endforeach()
+  set_property(GLOBAL APPEND_STRING PROPERTY wyvern_usage_content "${line}\n")
+endfunction()
+
+)cmake";
+
+  // Writes the files, or only the reasons why they would not be exact.
+  constexpr auto usage_dumps_generation = R"cmake(
+get_property(wyvern_usage_unsupported GLOBAL PROPERTY wyvern_usage_unsupported)
+if(wyvern_usage_unsupported)
+  file(WRITE "${wyvern_usage_directory}/unsupported.txt" "${wyvern_usage_unsupported}")
+else()
+  set(wyvern_usage_toolchain "standard\t${CMAKE_CXX_STANDARD}\t${CMAKE_CXX_STANDARD_COMPUTED_DEFAULT}\n")
+  foreach(wyvern_usage_standard 98 11 14 17 20 23 26)
+    string(APPEND wyvern_usage_toolchain "features\t${wyvern_usage_standard}\t${CMAKE_CXX${wyvern_usage_standard}_COMPILE_FEATURES}\n")
+  endforeach()
+  string(APPEND wyvern_usage_toolchain "implicit_include_directories\t${CMAKE_CXX_IMPLICIT_INCLUDE_DIRECTORIES}\n")
+  string(APPEND wyvern_usage_toolchain "implicit_link_directories\t${CMAKE_PLATFORM_IMPLICIT_LINK_DIRECTORIES};${CMAKE_CXX_IMPLICIT_LINK_DIRECTORIES}\n")
+  get_property(wyvern_usage_content GLOBAL PROPERTY wyvern_usage_content)
+  file(GENERATE OUTPUT "${wyvern_usage_directory}/usage-$<CONFIG>.txt"
+    CONTENT "configuration\t$<CONFIG>\n${wyvern_usage_toolchain}${wyvern_usage_content}")
+endif()
+)cmake";
+
+  auto split(std::string_view text, char separator) -> std::vector<std::string_view>
+  {
+    std::vector<std::string_view> parts;
+    while(true)
+    {
+      const auto found = text.find(separator);
+      parts.push_back(text.substr(0, found));
+      if(found == std::string_view::npos)
+        return parts;
+      text.remove_prefix(found + 1);
+    }
+  }
+
+  // Elements of a CMake list, without the empty ones.
+  auto split_list(std::string_view list) -> std::vector<std::string>
+  {
+    std::vector<std::string> elements;
+    for(const auto element : split(list, ';'))
+    {
+      if(!element.empty())
+        elements.emplace_back(element);
+    }
+    return elements;
+  }
+
+  auto normalized(const std::string& file_path) -> std::string
+  {
+    return path(file_path).normalize().string();
+  }
+
+  // Standards in order, as CMake names them in `cxx_std_<standard>`.
+  constexpr const char* standards[] = { "98", "11", "14", "17", "20", "23", "26" };
+
+  auto standard_rank(std::string_view standard) -> int
+  {
+    for(int rank = 0; rank < static_cast<int>(std::size(standards)); ++rank)
+    {
+      if(standard == standards[rank])
+        return rank;
+    }
+    return -1;
+  }
+
+  struct DumpedTarget
+  {
+    LinkedTarget linked;
+    std::string include_directories; // Only logged, see `read_usage_dump()`.
+    std::string definitions;
+  };
+
+  struct Consumer
+  {
+    std::string name;
+    std::string dependency;
+    std::vector<std::string> include_directories;
+    std::vector<std::string> definitions;
+    std::vector<std::string> options;
+    std::vector<std::string> features;
+    std::vector<std::string> link_options;
+    std::vector<std::string> link_directories;
+  };
+
+  // Reads the file generated for one configuration, the values are those of this configuration.
+  auto read_usage_dump(std::string_view content, const path& dump_path) -> Configuration
+  {
+    std::string standard;
+    std::string default_standard;
+    std::map<std::string, std::vector<std::string>> features; // By standard.
+    std::vector<std::string> implicit_include_directories;
+    std::vector<std::string> implicit_link_directories;
+    std::map<std::string, std::string> aliases;
+    std::map<std::string, DumpedTarget> targets;
+    std::vector<Consumer> consumers;
+
+    Configuration configuration;
+    for(const auto line : split(content, '\n'))
+    {
+      if(line.empty())
+        continue;
+      const auto fields = split(line, '\t');
+      const auto field = [&](std::size_t index){
+        if(index >= fields.size())
+          throw failure(format("invalid line in {}: {}", dump_path.string(), line));
+        return std::string{ fields[index] };
+      };
+
+      const auto& kind = fields[0];
+      if(kind == "configuration")
+        configuration.name = field(1);
+      else if(kind == "standard")
+      {
+        standard = field(1);
+        default_standard = field(2);
+      }
+      else if(kind == "features")
+        features[field(1)] = split_list(field(2));
+      else if(kind == "implicit_include_directories")
+        implicit_include_directories = split_list(field(1));
+      else if(kind == "implicit_link_directories")
+        implicit_link_directories = split_list(field(1));
+      else if(kind == "alias")
+        aliases[field(1)] = field(2);
+      else if(kind == "target")
+      {
+        auto& target = targets[field(1)];
+        auto type = field(2);
+        const auto suffix = std::string_view{ "_LIBRARY" };
+        if(type.size() > suffix.size() && type.compare(type.size() - suffix.size(), suffix.size(), suffix) == 0)
+          type.resize(type.size() - suffix.size());
+        target.linked.type = type;
+        target.linked.linker_file = field(3);
+        target.linked.link_items = split_list(field(4));
+        target.include_directories = field(5);
+        target.definitions = field(6);
+      }
+      else if(kind == "consumer")
+        consumers.push_back({ field(1), field(2), split_list(field(3)), split_list(field(4)), split_list(field(5)),
+                              split_list(field(6)), split_list(field(7)), split_list(field(8)) });
+      else
+        throw failure(format("invalid line in {}: {}", dump_path.string(), line));
+    }
+
+    const auto resolved = [&](const std::string& name){
+      const auto found = aliases.find(name);
+      return found == aliases.end() ? name : found->second;
+    };
+    std::map<std::string, LinkedTarget> closure;
+    for(const auto& [name, target] : targets)
+    {
+      auto& linked = closure[name];
+      linked = target.linked;
+      for(auto& item : linked.link_items)
+        item = resolved(item);
+    }
+
+    const auto threshold = standard.empty() ? default_standard : standard;
+    for(const auto& consumer : consumers)
+    {
+      if(!consumer.link_options.empty())
+        throw unsupported(format("{} has link options", consumer.dependency));
+      if(!consumer.link_directories.empty())
+        throw unsupported(format("{} has link directories", consumer.dependency));
+
+      Target result;
+      auto& compilation = result.language_compilation["CXX"];
+      for(const auto& directory : consumer.include_directories)
+      {
+        const auto include_directory = normalized(directory);
+        const auto is_implicit = std::any_of(implicit_include_directories.begin(), implicit_include_directories.end(), [&](const std::string& implicit_directory){
+          return normalized(implicit_directory) == include_directory;
+        });
+        if(is_implicit) // Never passed to the compiler.
+          continue;
+        if(std::find(compilation.include_directories.begin(), compilation.include_directories.end(), include_directory)
+           == compilation.include_directories.end())
+          compilation.include_directories.push_back(include_directory);
+      }
+
+      std::set<std::string> definitions;
+      for(const auto& definition : consumer.definitions)
+        definitions.insert(definition.rfind("-D", 0) == 0 ? definition.substr(2) : definition);
+      compilation.defines.assign(definitions.begin(), definitions.end());
+
+      std::vector<std::string> options; // Each once, like CMake does.
+      for(const auto& option : consumer.options)
+      {
+        if(option.rfind("SHELL:", 0) == 0)
+          throw unsupported(format("compile option {} of {}", option, consumer.dependency));
+        if(std::find(options.begin(), options.end(), option) == options.end())
+          options.push_back(option);
+      }
+      for(const auto& option : options)
+        append(compilation.compilation_flags, parse_values(option));
+
+      // Only the features which need a newer standard than the one used anyway add a flag.
+      for(const auto& feature : consumer.features)
+      {
+        std::string needed_standard;
+        if(feature.rfind("cxx_std_", 0) == 0)
+          needed_standard = feature.substr(std::string_view{ "cxx_std_" }.size());
+        for(const auto candidate : standards)
+        {
+          if(!needed_standard.empty())
+            break;
+          const auto& candidate_features = features[candidate];
+          if(std::find(candidate_features.begin(), candidate_features.end(), feature) != candidate_features.end())
+            needed_standard = candidate;
+        }
+        const auto needed_rank = standard_rank(needed_standard);
+        if(needed_rank < 0 || standard_rank(threshold) < 0 || needed_rank > standard_rank(threshold))
+          throw unsupported(format("compile feature {} of {} needs a standard flag", feature, consumer.dependency));
+      }
+
+      const auto dependency = resolved(consumer.dependency);
+      result.link_libraries = link_libraries(dependency, closure, implicit_link_directories);
+
+      if(is_logging_enabled(LogLevel::debug))
+      {
+        // What each target of the closure brings, knowing that CMake puts it together as above.
+        std::set<std::string> used{ dependency };
+        std::vector<std::string> unvisited{ dependency };
+        while(!unvisited.empty())
+        {
+          const auto name = unvisited.back();
+          unvisited.pop_back();
+          const auto found = targets.find(name);
+          if(found == targets.end())
+            continue;
+          const auto& target = found->second;
+          log(LogLevel::debug, "usage of {} ({}) from {} ({}): library '{}', include directories '{}', definitions '{}'",
+              consumer.name, configuration.name, name, target.linked.type, target.linked.linker_file, target.include_directories, target.definitions);
+          for(const auto& item : closure.at(name).link_items)
+          {
+            if(used.insert(item).second)
+              unvisited.push_back(item);
+          }
+        }
+      }
+      configuration.targets[consumer.name] = std::move(result);
+    }
+    return configuration;
+  }
+
+}
+
+  auto usage_dumps_code(const std::vector<std::pair<std::string, std::string>>& targets) -> std::string
+  {
+    std::string code = usage_dumps_functions;
+    for(const auto& [name, dependency] : targets)
+      code += format("wyvern_usage_consumer(\"{}{}\" \"{}\" \"{}\")\n", target_prefix, name, name, dependency);
+    code += usage_dumps_generation;
+    return code;
+  }
+
+  auto read_usage_dumps(const dir_path& build_directory_path) -> DependenciesInfo
+  {
+    TraceSpan span{ "read_usage_dumps" };
+    const auto dumps_path = build_directory_path / dir_path(usage_dumps_directory_name);
+    const auto unsupported_path = dumps_path / path("unsupported.txt");
+    if(butl::file_exists(unsupported_path))
+    {
+      const MappedFile file{ unsupported_path };
+      std::vector<std::string_view> reasons;
+      for(const auto reason : split(file.content(), '\n'))
+      {
+        if(!reason.empty())
+          reasons.push_back(reason);
+      }
+      throw unsupported(format("{}", fmt::join(reasons, ", ")));
+    }
+
+    DependenciesInfo dependencies;
+    butl::path_search(path("usage-*.txt"), [&](path dump_path, const std::string&, bool){
+      const MappedFile file{ dumps_path / dump_path };
+      auto configuration = read_usage_dump(file.content(), dumps_path / dump_path);
+      auto name = configuration.name;
+      dependencies.configurations[name] = std::move(configuration);
+      return true;
+    }, dumps_path);
+
+    if(dependencies.empty())
+      throw failure(format("CMake did not generate the usage requirements in {}", dumps_path.string()));
+    span.arg("configurations", dependencies.configurations.size());
+    return dependencies;
+  }
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <libwyvern/wyvern.hpp>
+#include <libwyvern/utility.hpp>
+#include <libwyvern/export.hpp>
+
+namespace wyvern::detail {
+
+  // Extraction from a single generated project (see `Backend::generated_properties`): while generating its build-system,
+  // CMake evaluates the usage requirements of each generated target, and of every target of its link closure,
+  // into files (see `file(GENERATE)`) which are then read instead of comparing the project with a control one.
+  // What these files can't tell exactly as the comparison would throws `unsupported` (see export-files.hpp).
+
+  // Where the generated project writes the files, in its build directory.
+  inline constexpr auto usage_dumps_directory_name = "wyvern-usage";
+
+  // CMake code to append to the generated project, once its targets are defined.
+  // `targets`: the normalized name of each generated target (see `target_prefix`) with the dependency it links to.
+  LIBWYVERN_SYMEXPORT
+  auto usage_dumps_code(const std::vector<std::pair<std::string, std::string>>& targets) -> std::string;
+
+  // Reads the files written in the build directory when CMake generated the build-system.
+  LIBWYVERN_SYMEXPORT
+  auto read_usage_dumps(const dir_path& build_directory_path) -> DependenciesInfo;
+
+}
@@ -0,0 +1,504 @@
+#include <libwyvern/utility.hpp>
+#include <libwyvern/context.hpp>
+
+#include <random>
+#include <cctype>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <chrono>
+#include <condition_variable>
+
+#include <libbutl/filesystem.mxx>
+#include <libbutl/fdstream.mxx>
+#include <libbutl/string-parser.mxx>
+
+#ifdef _WIN32
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#else
+#  include <cerrno>
+#  include <cstring>
+#  include <fcntl.h>
+#  include <unistd.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <sys/file.h>
+#endif
+
+namespace wyvern::detail {
+namespace {
+
+  // Process-wide logging settings, used outside of calls.
+  std::atomic<bool> is_logging_enabled_flag{ false };
+  std::atomic<LogLevel> enabled_log_level{ LogLevel::debug };
+
+  thread_local CallContext* thread_context = nullptr;
+
+  // Messages waiting for the sink, delivered by a background thread so that logging
+  // only costs formatting the message, never writing it.
+  class LogQueue
+  {
+    static constexpr std::size_t capacity = 4096; // Messages, logging waits beyond.
+
+    struct Message
+    {
+      LogLevel level;
+      std::string text;
+      std::shared_ptr<const LogSink> sink; // Of the call which logged it, the process-wide sink if null.
+    };
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Message> messages;
+    std::size_t delivering = 0; // Messages taken by the background thread but not delivered yet.
+    bool is_stopping = false;
+    std::thread thread; // Started with the first message.
+
+    std::mutex sink_mutex;
+    LogSink sink; // Standard output if empty.
+
+    auto deliver(std::vector<Message>& batch) -> void
+    {
+      const std::lock_guard<std::mutex> lock{ sink_mutex };
+      bool is_written_to_output = false;
+      for(const auto& message : batch)
+      {
+        const auto& message_sink = message.sink ? *message.sink : sink;
+        if(!message_sink)
+        {
+          std::cout << "wyvern: " << message.text << '\n';
+          is_written_to_output = true;
+          continue;
+        }
+
+        try
+        {
+          message_sink(message.level, message.text);
+        }
+        catch(...)
+        {
+          // Nowhere to report it, the logging thread must keep delivering.
+        }
+      }
+
+      if(is_written_to_output)
+        std::cout.flush(); // Once per batch, not per message.
+    }
+
+    auto run() -> void
+    {
+      std::vector<Message> batch;
+      std::unique_lock<std::mutex> lock{ mutex };
+      while(true)
+      {
+        changed.wait(lock, [&]{ return !messages.empty() || is_stopping; });
+        if(messages.empty())
+          return; // Stopping, everything was delivered.
+
+        batch.assign(std::make_move_iterator(messages.begin()), std::make_move_iterator(messages.end()));
+        messages.clear();
+        delivering = batch.size();
+        lock.unlock();
+        changed.notify_all(); // Room for waiting writers.
+
+        deliver(batch);
+        batch.clear();
+
+        lock.lock();
+        delivering = 0;
+        changed.notify_all(); // Flushed.
+      }
+    }
+
+  public:
+    LogQueue() = default;
+    LogQueue(const LogQueue&) = delete;
+    LogQueue& operator=(const LogQueue&) = delete;
+
+    ~LogQueue()
+    {
+      {
+        const std::lock_guard<std::mutex> lock{ mutex };
+        is_stopping = true;
+      }
+      changed.notify_all();
+      if(thread.joinable())
+        thread.join();
+    }
+
+    auto push(LogLevel level, std::string text, std::shared_ptr<const LogSink> message_sink) -> void
+    {
+      {
+        std::unique_lock<std::mutex> lock{ mutex };
+        if(!thread.joinable())
+          thread = std::thread{ [this]{ run(); } };
+        changed.wait(lock, [&]{ return messages.size() < capacity; });
+        messages.push_back({ level, std::move(text), std::move(message_sink) });
+      }
+      changed.notify_all();
+    }
+
+    auto flush() -> void
+    {
+      std::unique_lock<std::mutex> lock{ mutex };
+      changed.wait(lock, [&]{ return messages.empty() && delivering == 0; });
+    }
+
+    auto set_sink(LogSink new_sink) -> void
+    {
+      flush();
+      const std::lock_guard<std::mutex> lock{ sink_mutex };
+      sink = std::move(new_sink);
+    }
+  };
+
+  auto log_queue() -> LogQueue&
+  {
+    static LogQueue queue;
+    return queue;
+  }
+
+}}
+
+namespace wyvern {
+
+  bool enable_logging(bool is_enabled)
+  {
+    return detail::is_logging_enabled_flag.exchange(is_enabled);
+  }
+
+  LogLevel set_log_level(LogLevel level)
+  {
+    return detail::enabled_log_level.exchange(level);
+  }
+
+  void set_log_sink(LogSink sink)
+  {
+    detail::log_queue().set_sink(std::move(sink));
+  }
+
+  void flush_log()
+  {
+    detail::log_queue().flush();
+  }
+
+}
+
+namespace wyvern::detail {
+
+  auto current_context() -> CallContext*
+  {
+    return thread_context;
+  }
+
+  ScopedContext::ScopedContext(CallContext* context)
+    : previous(thread_context)
+  {
+    thread_context = context;
+  }
+
+  ScopedContext::~ScopedContext()
+  {
+    thread_context = previous;
+  }
+
+  auto is_logging_enabled(LogLevel level) -> bool
+  {
+    if(const auto context = thread_context)
+      return context->is_logging_enabled && level <= context->log_level;
+
+    return is_logging_enabled_flag.load(std::memory_order_relaxed)
+        && level <= enabled_log_level.load(std::memory_order_relaxed);
+  }
+
+  auto write_log(LogLevel level, std::string message) -> void
+  {
+    const auto context = thread_context;
+    log_queue().push(level, std::move(message), context ? context->log_sink : nullptr);
+  }
+
+  int random_int(int min_value, int max_value){
+    if(const auto context = thread_context)
+      return context->random_int(min_value, max_value);
+
+    static std::mutex engine_mutex; // Calls can run concurrently.
+    const std::lock_guard<std::mutex> lock{ engine_mutex };
+    static std::random_device device;
+    static std::seed_seq seed{device(), device(), device(), device(), device(), device(), device(), device()};
+    static std::default_random_engine engine(seed);
+    std::uniform_int_distribution<int> distribution(min_value, max_value);
+    return distribution(engine);
+  }
+
+namespace {
+
+  // Characters replaced in names, runs of them become a single '_'.
+  // '-' is kept, it is valid in CMake target names and file names.
+  auto is_name_separator(char c) -> bool
+  {
+    switch(c)
+    {
+      case ' ': case '\t': case '\n': case '\v': case '\f': case '\r':
+      case '|': case '.': case ':': case '(': case ')':
+        return true;
+      default:
+        return false;
+    }
+  }
+
+}
+
+  auto normalize_name(const std::string& name) -> std::string
+  {
+    // NOTE: will not work with unicode.....
+    std::string normalized_name;
+    normalized_name.reserve(name.size());
+    bool is_after_separator = false;
+    for(const char c : name)
+    {
+      if(is_name_separator(c))
+      {
+        if(!is_after_separator)
+          normalized_name.push_back('_');
+        is_after_separator = true;
+      }
+      else
+      {
+        normalized_name.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+        is_after_separator = false;
+      }
+    }
+    return normalized_name;
+  }
+
+  auto parse_values(const std::string& values) -> std::vector<std::string>
+  {
+    return butl::string_parser::parse_quoted(values, true);
+  }
+
+  auto escape_braces(std::string text) -> std::string
+  {
+    const auto brace_count = std::count_if(text.begin(), text.end(), [](char c){ return c == '{' || c == '}'; });
+    if(brace_count == 0)
+      return text;
+
+    std::string escaped;
+    escaped.reserve(text.size() + brace_count);
+    for(const char c : text)
+    {
+      escaped.push_back(c);
+      if(c == '{' || c == '}')
+        escaped.push_back(c);
+    }
+    return escaped;
+  }
+
+  auto write_to_file(path file_path, const std::string& content) -> void
+  {
+    log(LogLevel::debug, "writing into file {}", file_path.string());
+    using namespace butl;
+    static const auto open_mode = fdopen_mode::truncate | fdopen_mode::create;
+    ofdstream file { file_path, open_mode };
+    file << content; // Assuming we are in text mode.
+    file.close(); // Throws exceptions if there have been errors while writing.
+  }
+
+  auto write_file_if_changed(path file_path, const std::string& content) -> bool
+  {
+    if(butl::file_exists(file_path) && MappedFile{ file_path }.content() == content)
+    {
+      log(LogLevel::debug, "unchanged file {}", file_path.string());
+      return false;
+    }
+
+    write_to_file(file_path, content);
+    return true;
+  }
+
+  auto create_directories(dir_path directory_path) -> void
+  {
+    log(LogLevel::debug, "creating directories {}", directory_path.string());
+    const auto result = butl::try_mkdir_p(directory_path);
+    if(result != butl::mkdir_status::success && result != butl::mkdir_status::already_exists){
+      throw failure(format("Failed to create directory {}", directory_path.normalize(true, true).string()));
+    }
+  }
+
+namespace {
+
+  // How often a lock held by someone else is tried again, waiting is interruptible in between.
+  constexpr auto lock_retry_interval = std::chrono::milliseconds{ 50 };
+
+}
+
+#ifdef _WIN32
+  MappedFile::MappedFile(const path& file_path)
+  {
+    const auto fail = [&]{
+      throw failure(format("Failed to map file {} (error {})", file_path.string(), GetLastError()));
+    };
+
+    const HANDLE file = CreateFileA(file_path.string().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if(file == INVALID_HANDLE_VALUE)
+      fail();
+
+    LARGE_INTEGER file_size;
+    if(!GetFileSizeEx(file, &file_size))
+    {
+      CloseHandle(file);
+      fail();
+    }
+
+    size = static_cast<std::size_t>(file_size.QuadPart);
+    if(size != 0) // Empty files cannot be mapped.
+    {
+      const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if(mapping != nullptr)
+      {
+        data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        CloseHandle(mapping); // The view keeps the mapping alive.
+      }
+    }
+    CloseHandle(file);
+
+    if(size != 0 && data == nullptr)
+      fail();
+  }
+
+  MappedFile::~MappedFile()
+  {
+    if(data != nullptr)
+      UnmapViewOfFile(data);
+  }
+
+  FileLock::FileLock(const path& file_path)
+  {
+    handle = CreateFileA(file_path.string().c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                         nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(handle == INVALID_HANDLE_VALUE)
+      throw failure(format("Failed to open lock file {} (error {})", file_path.string(), GetLastError()));
+
+    bool is_waiting = false;
+    while(true)
+    {
+      OVERLAPPED whole_file{};
+      if(LockFileEx(handle, LOCKFILE_EXCLUSIVE_LOCK | LOCKFILE_FAIL_IMMEDIATELY, 0, MAXDWORD, MAXDWORD, &whole_file))
+        return;
+
+      const auto error = GetLastError();
+      if(error != ERROR_LOCK_VIOLATION)
+      {
+        CloseHandle(handle);
+        throw failure(format("Failed to lock file {} (error {})", file_path.string(), error));
+      }
+
+      if(!is_waiting)
+        log(LogLevel::info, "waiting for lock {}", file_path.string());
+      is_waiting = true;
+      try
+      {
+        check_interruption();
+      }
+      catch(...)
+      {
+        CloseHandle(handle);
+        throw;
+      }
+      std::this_thread::sleep_for(lock_retry_interval);
+    }
+  }
+
+  FileLock::~FileLock()
+  {
+    CloseHandle(handle); // Releases the lock.
+  }
+#else
+  MappedFile::MappedFile(const path& file_path)
+  {
+    const auto fail = [&]{
+      throw failure(format("Failed to map file {}: {}", file_path.string(), std::strerror(errno)));
+    };
+
+    const int file = ::open(file_path.string().c_str(), O_RDONLY | O_CLOEXEC);
+    if(file == -1)
+      fail();
+
+    struct stat file_status;
+    if(::fstat(file, &file_status) == -1)
+    {
+      ::close(file);
+      fail();
+    }
+
+    size = static_cast<std::size_t>(file_status.st_size);
+    if(size != 0) // Empty files cannot be mapped.
+    {
+      void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+      if(mapping != MAP_FAILED)
+      {
+        data = static_cast<const char*>(mapping);
+        ::madvise(mapping, size, MADV_SEQUENTIAL);
+      }
+    }
+    ::close(file); // The mapping stays valid.
+
+    if(size != 0 && data == nullptr)
+      fail();
+  }
+
+  MappedFile::~MappedFile()
+  {
+    if(data != nullptr)
+      ::munmap(const_cast<char*>(data), size);
+  }
+
+  FileLock::FileLock(const path& file_path)
+  {
+    descriptor = ::open(file_path.string().c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if(descriptor == -1)
+      throw failure(format("Failed to open lock file {}: {}", file_path.string(), std::strerror(errno)));
+
+    // flock() locks belong to the open file description: they also exclude the other threads of this process.
+    bool is_waiting = false;
+    while(::flock(descriptor, LOCK_EX | LOCK_NB) == -1)
+    {
+      if(errno != EWOULDBLOCK && errno != EINTR)
+      {
+        const auto error = std::strerror(errno);
+        ::close(descriptor);
+        throw failure(format("Failed to lock file {}: {}", file_path.string(), error));
+      }
+
+      if(!is_waiting)
+        log(LogLevel::info, "waiting for lock {}", file_path.string());
+      is_waiting = true;
+      try
+      {
+        check_interruption();
+      }
+      catch(...)
+      {
+        ::close(descriptor);
+        throw;
+      }
+      std::this_thread::sleep_for(lock_retry_interval);
+    }
+  }
+
+  FileLock::~FileLock()
+  {
+    ::close(descriptor); // Releases the lock.
+  }
+#endif
+
+  json read_json_file(path file_path)
+  {
+    const MappedFile file{ file_path };
+    const auto content = file.content();
+    return json::parse(content.begin(), content.end());
+  }
+
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+// Utilities shared by the implementation files of the library.
+// This header is not installed: it exposes the library's implementation dependencies.
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <exception>
+#include <utility>
+
+#include <nlohmann/json.hpp>
+#include <fmt/format.h>
+
+#include <libwyvern/wyvern.hpp>
+#include <libwyvern/export.hpp>
+
+namespace wyvern::detail {
+
+  using json = nlohmann::json;
+  using fmt::format; // could be std::format if support is available
+
+  struct failure : ExtractionError
+  {
+    using ExtractionError::ExtractionError;
+  };
+
+  // Targets of the generated projects are named `target_prefix` followed by the normalized
+  // dependency name. Without dependencies, all the targets of the project would be identical,
+  // so the control project only has one, `control_target`, which also makes it independent
+  // from the requested targets.
+  inline constexpr auto target_prefix = "wyvern_";
+  inline constexpr auto control_target = "control";
+
+  class CallContext; // See context.hpp.
+
+  // Context of the call this thread works for, null outside of calls.
+  LIBWYVERN_SYMEXPORT
+  auto current_context() -> CallContext*;
+
+  // Makes `context` the current one of this thread until destroyed, then restores the previous one.
+  // Used when entering a call, and in each thread working for it.
+  class LIBWYVERN_SYMEXPORT ScopedContext
+  {
+    CallContext* previous;
+
+  public:
+    explicit ScopedContext(CallContext* context);
+    ~ScopedContext();
+    ScopedContext(const ScopedContext&) = delete;
+    ScopedContext& operator=(const ScopedContext&) = delete;
+  };
+
+  // Whether messages of that level are logged, following the settings of the current call
+  // or, outside of calls, the process-wide ones (see `enable_logging()`).
+  LIBWYVERN_SYMEXPORT
+  auto is_logging_enabled(LogLevel level = LogLevel::info) -> bool;
+
+  // Queues the message for the current call's sink, see `Options::log_sink` and `set_log_sink()`.
+  // Only waits if the sink is so far behind that the queue is full.
+  LIBWYVERN_SYMEXPORT
+  auto write_log(LogLevel level, std::string message) -> void;
+
+  // Formats and queues the message, only if its level is enabled.
+  // The arguments are only referenced, but are evaluated by the caller: use `log_lazily()`
+  // for those costly to compute.
+  template<class... Args>
+  auto log(LogLevel level, std::string_view format_string, const Args&... args) -> void
+  {
+    if(is_logging_enabled(level))
+      write_log(level, fmt::vformat(format_string, fmt::make_format_args(args...)));
+  }
+
+  // Queues the message returned by `make_message()`, only called if the level is enabled:
+  // a disabled message costs nothing more than with `log()`.
+  template<class MakeMessage>
+  auto log_lazily(LogLevel level, MakeMessage&& make_message) -> void
+  {
+    if(is_logging_enabled(level))
+      write_log(level, std::forward<MakeMessage>(make_message)());
+  }
+
+  // From the current call's engine, or a process-wide one outside of calls.
+  LIBWYVERN_SYMEXPORT
+  int random_int(int min_value, int max_value);
+
+  LIBWYVERN_SYMEXPORT
+  auto normalize_name(const std::string& name) -> std::string;
+
+  LIBWYVERN_SYMEXPORT
+  auto escape_braces(std::string text) -> std::string;
+
+  LIBWYVERN_SYMEXPORT
+  auto parse_values(const std::string& values) -> std::vector<std::string>;
+
+  template<class T>
+  void append(std::vector<T>& values, const std::vector<T>& other_values)
+  {
+    values.insert(values.end(), other_values.begin(), other_values.end());
+  }
+
+  template<class T>
+  void append(std::vector<T>& values, std::vector<T>&& other_values)
+  {
+    values.insert(values.end(), std::make_move_iterator(other_values.begin()), std::make_move_iterator(other_values.end()));
+  }
+
+  // Calls `work(index)` for each index in [0, count) using at most `max_jobs` threads (no limit if 0).
+  // The threads work in the current call's context.
+  // Waits for all the work to be done before rethrowing the failure with the lowest index, if any.
+  template<class Work>
+  auto for_each_index_concurrently(std::size_t count, unsigned max_jobs, Work&& work) -> void
+  {
+    const auto jobs = max_jobs == 0 ? count : std::min<std::size_t>(count, max_jobs);
+    std::vector<std::exception_ptr> failures(count);
+    std::atomic<std::size_t> next_index{ 0 };
+    const auto context = current_context();
+    const auto worker = [&]{
+      const ScopedContext scoped_context{ context };
+      for(auto index = next_index++; index < count; index = next_index++)
+      {
+        try
+        {
+          work(index);
+        }
+        catch(...)
+        {
+          failures[index] = std::current_exception();
+        }
+      }
+    };
+
+    if(jobs <= 1)
+    {
+      worker();
+    }
+    else
+    {
+      std::vector<std::thread> threads;
+      for(std::size_t job = 0; job < jobs; ++job)
+        threads.emplace_back(worker);
+      for(auto& thread : threads)
+        thread.join();
+    }
+
+    for(const auto& failure : failures)
+    {
+      if(failure)
+        std::rethrow_exception(failure);
+    }
+  }
+
+  LIBWYVERN_SYMEXPORT
+  auto write_to_file(path file_path, const std::string& content) -> void;
+
+  // Only writes the file if its content changes, so that its modification time only changes with it
+  // (CMake and the build-systems rely on it). Returns whether it was written.
+  LIBWYVERN_SYMEXPORT
+  auto write_file_if_changed(path file_path, const std::string& content) -> bool;
+
+  LIBWYVERN_SYMEXPORT
+  auto create_directories(dir_path directory_path) -> void;
+
+  // Exclusive lock on a file (created if missing) until destroyed, between processes and between threads.
+  // Waiting for it stops if the current call must stop (see `check_interruption()`).
+  class LIBWYVERN_SYMEXPORT FileLock
+  {
+#ifdef _WIN32
+    void* handle = nullptr;
+#else
+    int descriptor = -1;
+#endif
+
+  public:
+    explicit FileLock(const path& file_path);
+    ~FileLock();
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+  };
+
+  // Read-only mapping of a whole file in memory.
+  class LIBWYVERN_SYMEXPORT MappedFile
+  {
+    const char* data = nullptr;
+    std::size_t size = 0;
+
+  public:
+    explicit MappedFile(const path& file_path);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    auto content() const -> std::string_view { return { data, size }; }
+  };
+
+  // Parses the json file in place, from its mapping.
+  LIBWYVERN_SYMEXPORT
+  json read_json_file(path file_path);
+
+}
@@ -3,216 +3,200 @@
 #include <iostream>
 #include <string>
 #include <sstream>
-#include <random>
-#include <regex>
 #include <atomic>
 #include <variant>
+#include <optional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+#include <set>
+#include <deque>
+#include <condition_variable>
 
-#include <nlohmann/json.hpp>
 #include <libbutl/process.mxx>
 #include <libbutl/filesystem.mxx>
 #include <libbutl/fdstream.mxx>
-#include <libbutl/string-parser.mxx>
-#include <fmt/format.h>
-
-using json = nlohmann::json;
-using fmt::format; // could be std::format if support is available
+#include <libbutl/sha256.mxx>
+
+#include <libwyvern/file-api.hpp>
+#include <libwyvern/diff.hpp>
+#include <libwyvern/symbols.hpp>
+#include <libwyvern/session.hpp>
+#include <libwyvern/utility.hpp>
+#include <libwyvern/trace.hpp>
+#include <libwyvern/context.hpp>
+#include <libwyvern/process-output.hpp>
+#include <libwyvern/export-files.hpp>
+#include <libwyvern/usage-dumps.hpp>
+#include <libwyvern/cmake-trace.hpp>
 
 namespace wyvern {
 
-  static std::atomic<bool> is_logging_enabled{ false };
-  bool enable_logging(bool is_enabled)
-  {
-    bool was_enabled = is_logging_enabled.exchange(is_enabled);
-    return was_enabled;
-  }
+  using namespace wyvern::detail;
+
+}
 
+namespace wyvern::cmake {
 namespace {
 
-  const auto target_prefix = "wyvern_";
+  // How often a running CMake process is checked for cancellation and timeouts.
+  constexpr auto interruption_check_interval = std::chrono::milliseconds{ 50 };
 
+  // How long the output of an exited CMake process is still read: processes it started can keep the pipes open.
+  constexpr auto output_grace_period = std::chrono::milliseconds{ 500 };
 
-  struct failure : std::runtime_error
+  auto stop_cmake(butl::process& cmake_process, const std::vector<std::string>& args) -> void
   {
-    using std::runtime_error::runtime_error;
-  };
-
+    log(LogLevel::info, "killing cmake {}", fmt::join(args, " "));
+    cmake_process.kill();
+    cmake_process.wait(true);
+  }
 
+  // Runs CMake until it exits, unless it takes more than `timeout` (no limit if 0)
+  // or the current call must stop: it is then killed. `consume_line` takes the lines meant for it (see `OutputCapture`).
+  auto run_cmake(const std::vector<std::string>& args, std::chrono::milliseconds timeout,
+                 const OutputCapture::LineConsumer& consume_line = nullptr) -> void
+  {
+    // run the command cmake
+    // throw if any error is found
+    check_interruption();
+    const ProcessPermit process_permit; // Waits while the call runs as many processes as allowed.
+    TraceSpan span{ "invoke_cmake" };
+    span.arg("args", args);
+    log(LogLevel::info, "cmake {}", fmt::join(args, " "));
+    std::vector<const char*> command{ "cmake" };
+    for(const auto& arg : args)
+    {
+      command.push_back(arg.c_str());
+    }
+    command.push_back(nullptr);
 
+    const auto context = current_context();
+    OutputCapture output{
+      context ? context->cmake_output_tail_size : Options{}.cmake_output_tail_size,
+      context ? context->cmake_output_handler : nullptr,
+      consume_line,
+    };
+    const auto record_output = [&]{
+      span.arg("output_bytes", output.size());
+      if(span.is_recording())
+        span.arg("output", output.tail());
+    };
 
-  struct Logger
-  {
-    std::stringstream logged;
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    butl::process cmake_process(command.data(), 0, -1, -1); // The output is read through pipes, see `OutputCapture`.
+    try
+    {
+      output.start(std::move(cmake_process.in_ofd), std::move(cmake_process.in_efd));
+      while(true)
+      {
+        // Never waits past the deadline: exiting after it is a timeout too.
+        const auto wait_duration = timeout.count() > 0
+          ? std::clamp(std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()),
+                       std::chrono::milliseconds{ 0 }, interruption_check_interval)
+          : interruption_check_interval;
+        if(const auto exited = cmake_process.timed_wait(wait_duration))
+        {
+          output.finish(output_grace_period);
+          record_output();
+          if(!*exited)
+          {
+            const auto& exit = *cmake_process.exit;
+            const auto status = exit.normal() ? format("exit code {}", exit.code()) : format("signal {}", exit.signal());
+            throw CMakeError(format("CMake process failed ({}): cmake {}", status, fmt::join(args, " ")), output.tail());
+          }
+          return;
+        }
 
-    Logger()
+        check_interruption();
+        if(timeout.count() > 0 && std::chrono::steady_clock::now() >= deadline)
+          throw ExtractionTimeout(format("CMake did not finish in {} ms: cmake {}", timeout.count(), fmt::join(args, " ")));
+      }
+    }
+    catch(const CMakeError&)
     {
-      if(is_logging_enabled)
-        logged << "wyvern: ";
+      throw;
     }
-    Logger(const Logger&) = delete;
-    Logger& operator=(const Logger&) = delete;
-    Logger(Logger&&) = default;
-    Logger& operator=(Logger&&) = default;
-
-    template<class Arg>
-    friend auto operator<<(Logger&& logger, Arg&& to_log)
-      -> Logger&&
+    catch(const ExtractionTimeout& error)
     {
-      if(is_logging_enabled)
-        logger.logged << std::forward<Arg>(to_log);
-      return std::move(logger);
+      stop_cmake(cmake_process, args);
+      output.finish(std::chrono::milliseconds{ 0 });
+      record_output();
+      const auto tail = output.tail();
+      throw ExtractionTimeout(tail.empty() ? error.what() : format("{}\n{}", error.what(), tail)); // Where it was stuck.
     }
-
-    ~Logger()
+    catch(...)
     {
-      if(is_logging_enabled)
-        std::cout << logged.str() <<std::endl;
+      stop_cmake(cmake_process, args);
+      output.finish(std::chrono::milliseconds{ 0 });
+      record_output();
+      throw;
     }
-  };
-
-  auto log() -> Logger { return {}; }
-
-  int random_int(int min_value, int max_value){
-    static std::random_device device;
-    static std::seed_seq seed{device(), device(), device(), device(), device(), device(), device(), device()};
-    static std::default_random_engine engine(seed);
-    std::uniform_int_distribution<int> distribution(min_value, max_value);
-    return distribution(engine);
   }
 
-  std::string to_lower_case(std::string s) {
-    std::transform(s.begin(), s.end(), s.begin(), [](auto c){ return std::tolower(c); });
-    return s;
 }
 
-  auto normalize_name(const std::string& name) -> std::string
-  {
-    // NOTE: will not work with unicode.....
-    const auto lowercase_name = to_lower_case(name);
-
-    static const auto regex_string = R"regex([\s | - | \. | \: | \( | \) )]+)regex";
-    static const auto replacement = "_";
-    static const std::regex to_replace(regex_string);
-
-    const auto normalized_name = std::regex_replace(lowercase_name, to_replace, replacement);
-    // log() << format("normalized \"{}\" to \"{}\"", name, normalized_name);
-    return normalized_name;
-  }
-
-  auto parse_values(const std::string& values) -> std::vector<std::string>
-  {
-    return butl::string_parser::parse_quoted(values, true);
-  }
-
-  template<class T>
-  void append(std::vector<T>& values, const std::vector<T>& other_values)
+  auto invoke_cmake(const std::vector<std::string>& args) -> void
   {
-    values.insert(values.end(), other_values.begin(), other_values.end());
+    run_cmake(args, {});
   }
 
-  template<class Range>
-  auto sort(Range& range)
-  {
-    using std::begin;
-    using std::end;
-    return std::sort(begin(range), end(range));
-  }
+namespace {
+  constexpr auto minimum_cmake_version = "3.10";
 
-  auto difference(const std::vector<std::string>& left, const std::vector<std::string>& right)
-  {
-    std::vector<std::string> diff;
-    std::set_difference(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(diff));
-    return diff;
-  }
+  // The first version of CMake with the "Ninja Multi-Config" generator.
+  constexpr auto ninja_multi_config_minimum_cmake_version = "3.17";
 
-  auto escape_braces(std::string text) -> std::string
-  {
-    static const auto left_brace_regex = std::regex("[{]");
-    static const auto right_brace_regex = std::regex("[}]");
-    text = std::regex_replace(text, left_brace_regex, "{{");
-    text = std::regex_replace(text, right_brace_regex, "}}");
-    return text;
-  }
+  // The first versions of CMake building in parallel (`--parallel`), several targets at once (`--target a b`),
+  // and linking object libraries (used by `Validation::compile`, static libraries before).
+  constexpr auto build_parallel_minimum_cmake_version = "3.12";
+  constexpr auto build_targets_minimum_cmake_version = "3.15";
+  constexpr auto object_library_link_minimum_cmake_version = "3.12";
 
-  auto write_to_file(path file_path, const std::string& content) -> void
+  enum class cmakefile_mode
   {
-    log() << format("writing into file {}", file_path.normalize(true, true).string());
-    using namespace butl;
-    static const auto open_mode = fdopen_mode::truncate | fdopen_mode::create;
-    ofdstream file { file_path, open_mode };
-    file << content; // Assuming we are in text mode.
-    file.close(); // Throws exceptions if there have been errors while writing.
-  }
+    without_dependencies,
+    with_dependencies,
+    with_usage_dumps, // With the dependencies, and the code writing their usage requirements (see `usage_dumps_code()`).
+    traced, // With the dependencies, configured with a trace of the packages' files (see `trace_arguments()`).
+  };
 
-  auto create_directories(dir_path directory_path) -> void
-  {
-    log() << format("creating directories {}", directory_path.normalize(true, true).string());
-    const auto result = butl::try_mkdir_p(directory_path);
-    if(result != butl::mkdir_status::success){
-      throw failure(format("Failed to create directory {}", directory_path.normalize(true, true).string()));
-    }
-  }
+  // Object libraries only compiled (never linked) to check compilation, see `Validation::compile`.
+  const auto check_target_prefix = "wyvern_check_";
 
-  json read_json_file(path file_path)
+  // A target of the generated project, with the name used in the generated names (targets, files).
+  struct ProjectTarget
   {
-    using namespace butl;
-    ifdstream file { file_path };
-    const json json_content = json::parse(file.read_text());
-    return json_content;
-  }
-
-}}
-
-namespace wyvern::cmake {
+    std::string dependency; // As requested, used to link to it.
+    std::string name; // Normalized dependency name.
+  };
 
-  auto invoke_cmake(const std::vector<std::string>& args) -> void
+  // Computed once per configuration, the names are used by each step of the generation.
+  auto project_targets(const Configuration& cmake_config, cmakefile_mode mode)
+    -> std::vector<ProjectTarget>
   {
-    // run the command cmake
-    // throw if any error is found
-    log() << format("cmake {}", fmt::join(args, " "));
-    std::vector<const char*> command{ "cmake" };
-    for(const auto& arg : args)
-    {
-      command.push_back(arg.c_str());
-    }
-    command.push_back(nullptr);
-
-    struct Pipes{
-      int in = 0;
-      int out = 1;
-      int err = 2;
-    };
-    auto pipes = []()->Pipes{
-      if(is_logging_enabled)
-        return {};
-      else
-        return { 0, -2, -2 };
-    }();
+    if(mode == cmakefile_mode::without_dependencies)
+      return { { control_target, control_target } };
 
-    butl::process cmake_process(command.data(), pipes.in, pipes.out, pipes.err);
-    if(!cmake_process.wait())
-    {
-      throw failure("CMake process failed");
-    }
+    std::vector<ProjectTarget> targets;
+    targets.reserve(cmake_config.targets.size());
+    for(const auto& target : cmake_config.targets)
+      targets.push_back({ target, normalize_name(target) });
+    return targets;
   }
-namespace {
-  constexpr auto minimum_cmake_version = "3.10";
-
-  enum class cmakefile_mode
-  {
-    without_dependencies,
-    with_dependencies,
-  };
 
-  auto generate_cmakefile_code(const Configuration& cmake_config, cmakefile_mode mode)
+  auto generate_cmakefile_code(const std::string& project_name, const Configuration& cmake_config, const std::vector<ProjectTarget>& targets,
+                               cmakefile_mode mode, Validation validation)
     -> std::string // content of the CMakeFile.txt
   {
     // TODO: replace by fmt::printf(filedesc, "...", ...);
     std::stringstream code;
     code << format("cmake_minimum_required(VERSION {})\n\n", minimum_cmake_version);
-    code << format("project(wyvern_{})\n\n", random_int(0, 99999999));
+    code << format("project({})\n\n", project_name);
 
-    if(mode == cmakefile_mode::with_dependencies)
+    if(mode != cmakefile_mode::without_dependencies)
     {
       for(const auto& package : cmake_config.packages)
       {
@@ -220,23 +204,65 @@ namespace {
       }
     }
 
-    for(const auto& target : cmake_config.targets)
+    for(const auto& target : targets)
     {
-      const auto suffix = normalize_name(target);
+      const auto& suffix = target.name;
       const auto target_name = format("{}{suffix}", target_prefix, fmt::arg("suffix", suffix));
       code << format("add_executable({} main_{suffix}.cpp header_{suffix}.hpp)\n", target_name, fmt::arg("suffix", suffix));
-      if(mode == cmakefile_mode::with_dependencies)
+      if(mode != cmakefile_mode::without_dependencies)
+      {
+        code << format("target_link_libraries({} PRIVATE {})\n", target_name, target.dependency);
+      }
+
+      if(validation == Validation::compile)
       {
-        code << format("target_link_libraries({} PRIVATE {})\n", target_name, target);
+        const auto check_target_name = format("{}{}", check_target_prefix, suffix);
+        code << format("if(CMAKE_VERSION VERSION_LESS {})\n", object_library_link_minimum_cmake_version);
+        code << format("  add_library({} STATIC main_{suffix}.cpp header_{suffix}.hpp)\n", check_target_name, fmt::arg("suffix", suffix));
+        code << "else()\n";
+        code << format("  add_library({} OBJECT main_{suffix}.cpp header_{suffix}.hpp)\n", check_target_name, fmt::arg("suffix", suffix));
+        code << "endif()\n";
+        if(mode != cmakefile_mode::without_dependencies)
+        {
+          code << format("target_link_libraries({} PRIVATE {})\n", check_target_name, target.dependency);
+        }
       }
     }
     code << "\n\n";
+
+    if(mode == cmakefile_mode::with_usage_dumps)
+    {
+      std::vector<std::pair<std::string, std::string>> dumped_targets;
+      for(const auto& target : targets)
+        dumped_targets.emplace_back(target.name, target.dependency);
+      code << usage_dumps_code(dumped_targets);
+    }
     return code.str();
   }
 
-  auto create_cmake_project(dir_path directory_path, const Configuration& cmake_config, cmakefile_mode mode, std::string test_code_format)
+  // Names of the generated targets to build to perform the requested validation.
+  auto validation_targets(const std::vector<ProjectTarget>& targets, Validation validation)
+    -> std::vector<std::string>
+  {
+    std::vector<std::string> names;
+    if(validation == Validation::none)
+      return names;
+
+    const auto prefix = validation == Validation::compile ? check_target_prefix : target_prefix;
+    for(const auto& target : targets)
+    {
+      names.push_back(format("{}{}", prefix, target.name));
+    }
+    return names;
+  }
+
+  // The files are only written if they change, so that a reused project is reconfigured incrementally.
+  auto create_cmake_project(dir_path directory_path, const std::string& project_name, const Configuration& cmake_config,
+                            const std::vector<ProjectTarget>& targets, cmakefile_mode mode, Validation validation, std::string test_code_format)
     -> void
   {
+    TraceSpan span{ "create_cmake_project" };
+    span.arg("targets", targets.size());
     // 1. create main.cpp and header.hpp
     static constexpr auto main_content = R"cpp(
 #include "header_{target_name}.hpp"
@@ -249,8 +275,8 @@ int main() {{  }}
 // This is a header to check the output with a header file (which should not be compiled).
     )cpp";
 
-    for(const auto& target : cmake_config.targets){
-      const auto target_name = normalize_name(target);
+    for(const auto& target : targets){
+      const auto& target_name = target.name;
       const auto main_cpp_path = directory_path / path(format("main_{}.cpp", target_name));
       const auto header_hpp_path = directory_path / path(format("header_{}.hpp", target_name));
 
@@ -268,111 +294,152 @@ int main() {{  }}
       }();
 
       const auto main_cpp_code = format(main_content, code_to_inject, fmt::arg("target_name", target_name));
-      write_to_file(main_cpp_path, main_cpp_code);
-      write_to_file(header_hpp_path, header_content);
+      write_file_if_changed(main_cpp_path, main_cpp_code);
+      write_file_if_changed(header_hpp_path, header_content);
     }
 
     // 2. create the cmakefile with the right content
     const auto cmakefile_path = directory_path / path("CMakeLists.txt");
-    const auto cmakefile_content = generate_cmakefile_code(cmake_config, mode);
-    write_to_file(cmakefile_path, cmakefile_content);
+    const auto cmakefile_content = generate_cmakefile_code(project_name, cmake_config, targets, mode, validation);
+    write_file_if_changed(cmakefile_path, cmakefile_content);
   }
 
-  struct CodeModel
+  // Must be done before configuring: CMake writes the replies when generating the build-system.
+  // Without the codemodel, only the files CMake read are reported (see `read_cmake_files_reply()`).
+  auto write_cmake_file_api_query(dir_path build_directory_path, bool is_codemodel_needed = true)
+    -> void
   {
-    json index;
-    struct Configuration
-    {
-      std::map<std::string, json> targets;
-    };
-    std::map<std::string, Configuration> configs;
-  };
+    static constexpr auto cmake_file_api_query_json = R"JSON(
+{
+  "requests" : [
+      {
+          "kind": "codemodel",
+          "version": { "major": 2 }
+      },
+      {
+          "kind": "cmakeFiles",
+          "version": { "major": 1 }
+      }
+  ]
+}
+    )JSON";
 
-  auto find_index_file_path(dir_path reply_dir)
-  {
-    // There can be only 1 json file starting with "index" in that directory.
-    path found_path;
-    butl::path_search(path("index-*.json"), [&](path path, const std::string&, bool){
-      found_path = path;
-      return false;
-    }, reply_dir);
+    static constexpr auto cmake_files_query_json = R"JSON(
+{
+  "requests" : [
+      {
+          "kind": "cmakeFiles",
+          "version": { "major": 1 }
+      }
+  ]
+}
+    )JSON";
 
-    if(found_path.empty())
-      throw failure(format("Failed to find index json file in {}", reply_dir.normalize(true, true).string()));
-    return (reply_dir / found_path).normalize(true, true);
+    const dir_path query_directory_path = build_directory_path / dir_path(".cmake/api/v1/query/client-wyvern/");
+    create_directories(query_directory_path);
+
+    const path query_file_path = query_directory_path / "query.json";
+    write_file_if_changed(query_file_path, is_codemodel_needed ? cmake_file_api_query_json : cmake_files_query_json);
   }
 
-  auto read_cmake_api_reply_json(dir_path reply_dir)
+  auto read_cmake_file_api_reply(dir_path build_directory_path, SymbolTable& symbols, unsigned max_jobs)
     -> CodeModel
   {
-    CodeModel codemodel;
-    // 1. read the index to find the right codemodel file
-    const auto index_path = find_index_file_path(reply_dir);
-    codemodel.index = read_json_file(index_path);
-    // log() << "INDEX : " << codemodel.index;
-
-    // 2. read the codemodel file to find the right target files
-    const auto codemodel_filename = codemodel.index["reply"]["client-wyvern"]["query.json"]["responses"][0]["jsonFile"];
-    const auto codemodel_path = reply_dir / path(codemodel_filename);
-    // log() << "CodeModel file : " << codemodel_path.string();
-    const auto codemodel_info = read_json_file(codemodel_path);
-
+    const dir_path reply_directory_path = build_directory_path / dir_path(".cmake/api/v1/reply/");
+    auto codemodel = read_cmake_api_reply_json(reply_directory_path, symbols, max_jobs);
 
-    // 3. gather information about each target.
-    for(const auto& config : codemodel_info["configurations"])
+    // The targets only used to check compilation are not part of the information we want.
+    for(auto& [config_name, config] : codemodel.configs)
     {
-      CodeModel::Configuration config_info;
-      const auto config_name = config["name"];
-      for(const auto& target : config["targets"])
+      for(auto target_it = config.targets.begin(); target_it != config.targets.end();)
       {
-        auto target_name = target["name"];
-        if(target_name == "ALL_BUILD" || target_name == "ZERO_CHECK") // Skip targets generated by CMake for convenience.
-          continue;
-
-        const auto target_file = target["jsonFile"];
-        const auto target_path = reply_dir / path(target_file);
-        auto target_json = read_json_file(target_path);
-        config_info.targets[target_name] = std::move(target_json);
+        if(target_it->first.rfind(check_target_prefix, 0) == 0)
+          target_it = config.targets.erase(target_it);
+        else
+          ++target_it;
       }
-      codemodel.configs[config_name] = std::move(config_info);
     }
     return codemodel;
   }
 
-  auto query_cmake_file_api(dir_path build_directory_path)
-    -> CodeModel
+  // Generators writing a build-system for several configurations at once.
+  auto is_multi_config_generator(const std::string& generator) -> bool
   {
+    return generator == "Ninja Multi-Config" || generator == "Xcode" || generator.rfind("Visual Studio", 0) == 0;
+  }
 
-    static constexpr auto cmake_file_api_query_json = R"JSON(
-{
-  "requests" : [
-      {
-          "kind": "codemodel",
-          "version": { "major": 2 }
-      }
-  ]
-}
-    )JSON";
+  // Generators whose build tool takes the number of jobs as `-j<n>` (make, ninja): the default one outside of Windows.
+  auto is_jobs_option_supported(const std::string& generator) -> bool
+  {
+#ifdef _WIN32
+    const bool is_default_supported = false; // Visual Studio.
+#else
+    const bool is_default_supported = true;
+#endif
+    return generator.empty() ? is_default_supported : generator.find("Makefiles") != std::string::npos || generator.rfind("Ninja", 0) == 0;
+  }
 
-    // 1. write the query file in the build directory
-    const dir_path query_directory_path = build_directory_path / dir_path(".cmake/api/v1/query/client-wyvern/");
-    create_directories(query_directory_path);
+  // Builds each of the `configurations`, or the only one if empty, with the build tool of `generator`.
+  // Before CMake 3.15, the targets are built one at a time, and before 3.12 the number of jobs is passed to make or ninja.
+  auto build_project(dir_path build_directory_path, const std::vector<std::string>& targets, unsigned max_jobs,
+                     const std::vector<std::string>& configurations, const std::string& generator, const std::string& cmake_version)
+    -> void
+  {
+    TraceSpan span{ "build_project" };
+    span.arg("targets", targets.size()).arg("configurations", configurations.size());
+    const std::vector<std::string> args{ "--build", build_directory_path.normalize(true, true).string() };
 
-    const path query_file_path = query_directory_path / "query.json";
-    write_to_file(query_file_path, cmake_file_api_query_json);
+    std::vector<std::string> jobs_args;
+    if(compare_versions(cmake_version, build_parallel_minimum_cmake_version) >= 0)
+    {
+      jobs_args.push_back("--parallel"); // Without a number of jobs, the build-system decides. The build counts as one CMake process.
+      if(max_jobs != 0)
+        jobs_args.push_back(std::to_string(max_jobs));
+    }
+    else if(max_jobs != 0 && is_jobs_option_supported(generator))
+      jobs_args = { "--", format("-j{}", max_jobs) };
 
-    // 2. invoke cmake in that directory
-    invoke_cmake({ build_directory_path.normalize(true, true).string() });
-    invoke_cmake({ "--build", build_directory_path.normalize(true, true).string() }); // Build to be sure it works
+    std::vector<std::vector<std::string>> targets_args; // One build for each.
+    if(targets.empty())
+      targets_args.emplace_back();
+    else if(compare_versions(cmake_version, build_targets_minimum_cmake_version) >= 0)
+    {
+      targets_args.push_back({ "--target" });
+      targets_args.back().insert(targets_args.back().end(), targets.begin(), targets.end());
+    }
+    else
+    {
+      for(const auto& target : targets)
+        targets_args.push_back({ "--target", target });
+    }
 
-    // 3. retrieve the JSON information
-    const dir_path reply_directory_path = build_directory_path / dir_path(".cmake/api/v1/reply/");
-    return read_cmake_api_reply_json(reply_directory_path);
+    const auto build = [&](const std::vector<std::string>& configuration_args){
+      for(const auto& target_args : targets_args)
+      {
+        auto build_args = args;
+        build_args.insert(build_args.end(), target_args.begin(), target_args.end());
+        build_args.insert(build_args.end(), configuration_args.begin(), configuration_args.end());
+        build_args.insert(build_args.end(), jobs_args.begin(), jobs_args.end()); // Last: after "--", the arguments are the build tool's.
+        run_cmake(build_args, current_timeouts().build);
+      }
+    };
+    if(configurations.empty())
+    {
+      build({});
+      return;
+    }
+    for(const auto& configuration : configurations)
+      build({ "--config", configuration });
   }
 
-  auto configure_project(dir_path project_path, dir_path build_path, const Configuration& cmake_config)
+  // `is_platform_detected`: the build directory was seeded with the platform files of the toolchain (see `probe_toolchain()`).
+  // `extra_args` are passed after the configuration's, with `consume_line` taking the output they make CMake print.
+  auto configure_project(dir_path project_path, dir_path build_path, const Configuration& cmake_config, bool is_platform_detected = false,
+                         const std::vector<std::string>& extra_args = {}, const OutputCapture::LineConsumer& consume_line = nullptr)
     -> void
   {
+    TraceSpan span{ "configure_project" };
+    span.arg("generator", cmake_config.generator).arg("packages", cmake_config.packages.size());
     const auto source_arg = project_path.normalize(true, true).string();
     const auto build_dir_arg = build_path.normalize(true, true).string();
 
@@ -387,10 +454,18 @@ int main() {{  }}
       args.insert(args.end(), { "-G", cmake_config.generator } );
     }
 
+    if(!cmake_config.configurations.empty())
+      args.push_back(format("-DCMAKE_CONFIGURATION_TYPES={}", fmt::join(cmake_config.configurations, ";")));
+
+    // Without it, a new build directory detects the platform again, ignoring the platform files it contains.
+    if(is_platform_detected)
+      args.push_back("-DCMAKE_PLATFORM_INFO_INITIALIZED:INTERNAL=1");
+
+    args.insert(args.end(), extra_args.begin(), extra_args.end());
     args.insert(args.end(), { "-S", source_arg, "-B", build_dir_arg });
 
 
-    invoke_cmake(args);
+    run_cmake(args, current_timeouts().configure, consume_line);
   }
 
 
@@ -410,12 +485,20 @@ namespace wyvern
     {
       if (keep_directory)
       {
-        log() << format("DIRECTORY NOT DELETED: {}", path_.normalize(true, true).string());
+        log(LogLevel::info, "DIRECTORY NOT DELETED: {}", path_.string());
       }
       else
       {
-        butl::rmdir_r(path_);
-        log() << format("Deleted directory {}", path_.normalize(true, true).string());
+        // Also called while unwinding (after a cancellation, for example): must not throw.
+        try
+        {
+          butl::rmdir_r(path_);
+          log(LogLevel::debug, "Deleted directory {}", path_.string());
+        }
+        catch(const std::exception& error)
+        {
+          log(LogLevel::warning, "failed to delete directory {}: {}", path_.string(), error.what());
+        }
       }
     }
   }
@@ -488,290 +571,1328 @@ namespace wyvern
   namespace
   {
 
-    auto extract_codemodel(const cmake::Configuration& config, cmake::cmakefile_mode mode, Options options)
-        -> cmake::CodeModel
+    auto log_codemodel(std::string_view name, const cmake::CodeModel& codemodel, const SymbolTable& symbols) -> void
     {
-      // step 1
-      const scoped_temp_dir project_dir{options.keep_generated_projects};
-      cmake::create_cmake_project(project_dir.path(), config, mode, options.code_format_to_inject_in_client);
+      if(!is_logging_enabled(LogLevel::debug))
+        return;
 
-      // step 2
-      const auto generator_name = config.generator.empty() ? std::string("default-generator") : normalize_name(config.generator);
-      const auto build_dir_name = format("build-{}", generator_name);
-      const auto build_dir_path = (project_dir.path() / dir_path(build_dir_name)).normalize(true, true);
-      cmake::configure_project(project_dir.path(), build_dir_path, config);
+      log(LogLevel::debug, "#### CODEMODEL {} : ####", name);
+      for (const auto& [config_name, config] : codemodel.configs)
+      {
+        log(LogLevel::debug, " - Configuration : {}", config_name);
+        for (const auto& [target_name, target] : config.targets)
+        {
+          log(LogLevel::debug, "   - Target: {}", target_name);
+          for (const auto& [language, compilation] : target.language_compilation)
+          {
+            log(LogLevel::debug, "    => {}", symbols.string(language));
+            for (const auto flag : compilation.compilation_flags)
+            {
+              log(LogLevel::debug, "       compilation flags: {}", symbols.string(flag));
+            }
 
-      // step 3
-      const auto codemodel = cmake::query_cmake_file_api(build_dir_path);
+            for (const auto define : compilation.defines)
+            {
+              log(LogLevel::debug, "       define: {}", symbols.string(define));
+            }
 
-      return codemodel;
-    }
+            for (const auto include_dir : compilation.include_directories)
+            {
+              log(LogLevel::debug, "       include dir: {}", symbols.string(include_dir));
+            }
+          }
 
-    auto log_codemodel(std::string_view name, const cmake::CodeModel& codemodel) -> void
-    {
-      log() << format("#### CODEMODEL {} : ####", name);
-      for (auto [config_name, config] : codemodel.configs)
-      {
-        log() << format(" - Configuration : {}", config_name);
-        for (auto [target_name, target_json] : config.targets)
-        {
-          log() << format("   - Target: {}", target_name);
-          auto compilation_groups = target_json["compileGroups"];
-          for (auto compile_info : compilation_groups)
+          for (const auto flag : target.link_flags)
           {
-            log() << format("    => {}", compile_info["language"]);
-            auto compile_fragments = compile_info["compileCommandFragments"];
-            if (!compile_fragments.is_null())
-              for (auto compile_flags : compile_fragments)
-              {
-                log() << format("       compilation flags: {}", compile_flags["fragment"]);
-              }
-
-            auto defines_fragments = compile_info["defines"];
-            if (!defines_fragments.is_null())
-              for (auto define : defines_fragments)
-              {
-                log() << format("       define: {}", define["define"]);
-              }
-
-            auto include_dirs = compile_info["includes"];
-            if (!include_dirs.is_null())
-              for (auto include_dir : include_dirs)
-              {
-                const bool is_system = include_dir["isSystem"];
-                const auto path = include_dir["path"];
-                log() << format("       include dir{}: {}", (is_system ? " (system)" : ""), path);
-              }
+            log(LogLevel::debug, "       link flags: {}", symbols.string(flag));
           }
 
-          const auto &link_info = target_json["link"];
-          if (!link_info.is_null())
+          for (const auto library : target.link_libraries)
           {
-            const auto &link_cmd_fragments = link_info["commandFragments"];
-            if (!link_cmd_fragments.is_null())
-              for (const auto &link_flags : link_cmd_fragments)
-              {
-                const auto &role = link_flags["role"];
-                if (role == "flags")
-                {
-                  log() << format("       link flags: {}", link_flags["fragment"]);
-                }
-                else if (role == "libraries")
-                {
-                  log() << format("       link libraries: {}", link_flags["fragment"]);
-                }
-                else
-                {
-                  log() << format("       failed to read link info (unknown role): {}", link_flags.dump());
-                }
-              }
+            log(LogLevel::debug, "       link libraries: {}", symbols.string(library));
           }
         }
       }
     }
 
-    auto extract_compilation(json compile_info) -> Compilation
-    {
-      Compilation compilation;
-      auto compile_fragments = compile_info["compileCommandFragments"];
-      if (!compile_fragments.is_null())
-      {
-        for (auto compile_flags : compile_fragments)
-        {
-          const auto flags = parse_values(compile_flags["fragment"]);
-          append(compilation.compilation_flags, flags);
-        }
-        sort(compilation.compilation_flags);
-      }
+    // Result cache: each entry is a json file named after the hash of everything that
+    // could change the result of an extraction, except the package files found by CMake
+    // (we cannot know them without running CMake), which are checked when loading the entry.
+    constexpr auto cache_format_version = 3; // Change when the content or meaning of cache entries changes.
+    constexpr auto cache_entry_extension = ".wyvern-cache.json";
 
+    auto to_json(const Compilation& compilation) -> json
+    {
+      return {
+        { "include_directories", compilation.include_directories },
+        { "compilation_flags", compilation.compilation_flags },
+        { "defines", compilation.defines },
+        { "source_files", compilation.source_files },
+      };
+    }
 
-      auto defines_fragments = compile_info["defines"];
-      if (!defines_fragments.is_null())
-      {
-        for (auto define : defines_fragments)
-        {
-          compilation.defines.push_back(define["define"]);
-        }
-        sort(compilation.defines);
-      }
+    auto to_json(const Target& target) -> json
+    {
+      json language_compilation = json::object();
+      for(const auto& [language, compilation] : target.language_compilation)
+        language_compilation[language] = to_json(compilation);
+
+      return {
+        { "name", target.name },
+        { "language_compilation", language_compilation },
+        { "libraries_directories", target.libraries_directories },
+        { "link_libraries", target.link_libraries },
+        { "link_flags", target.link_flags },
+      };
+    }
 
-      auto include_dirs = compile_info["includes"];
-      if (!include_dirs.is_null())
+    auto to_json(const DependenciesInfo& dependencies) -> json
+    {
+      json configurations = json::object();
+      for(const auto& [config_name, config] : dependencies.configurations)
       {
-        for (auto include_dir : include_dirs)
-        {
-          const bool is_system = include_dir["isSystem"]; // TODO: decide if we need to keep that info
-          const auto path = include_dir["path"];
-          compilation.include_directories.push_back(path);
-        }
-        sort(compilation.include_directories);
+        json targets = json::object();
+        for(const auto& [target_name, target] : config.targets)
+          targets[target_name] = to_json(target);
+        configurations[config_name] = { { "name", config.name }, { "targets", targets } };
       }
+      return { { "configurations", configurations } };
+    }
 
+    auto compilation_from_json(const json& compilation_json) -> Compilation
+    {
+      Compilation compilation;
+      compilation_json.at("include_directories").get_to(compilation.include_directories);
+      compilation_json.at("compilation_flags").get_to(compilation.compilation_flags);
+      compilation_json.at("defines").get_to(compilation.defines);
+      compilation_json.at("source_files").get_to(compilation.source_files);
       return compilation;
     }
 
-    auto extract_target(json target_json) -> Target
+    auto target_from_json(const json& target_json) -> Target
     {
       Target target;
-      target.name = target_json["name"];
-      auto compilation_groups = target_json["compileGroups"];
-      for (auto compile_info : compilation_groups)
-      {
-        const auto compile_language = compile_info["language"];
-        target.language_compilation[compile_language] = extract_compilation(compile_info);
-      }
-
-      const auto &link_info = target_json["link"];
-      if (!link_info.is_null())
-      {
-        const auto &link_cmd_fragments = link_info["commandFragments"];
-        if (!link_cmd_fragments.is_null())
-        {
-          for (const auto &link_flags : link_cmd_fragments)
-          {
-            const auto &role = link_flags["role"];
-            if (role == "flags")
-            {
-              const auto flags = parse_values(link_flags["fragment"]);
-              append(target.link_flags, flags);
-            }
-            else if (role == "libraries")
-            {
-              const auto libs = parse_values(link_flags["fragment"]);
-              append(target.link_libraries, libs);
-            } // TODO: for some reason there is no library directories, the paths to the libraries is always complete?
-            else
-            {
-              throw failure(format("failed to read link info (unknown role): {}", link_flags.dump()));
-            }
-          }
-          sort(target.link_flags);
-          sort(target.link_libraries);
-          sort(target.libraries_directories);
-        }
-      }
-
+      target_json.at("name").get_to(target.name);
+      for(const auto& [language, compilation_json] : target_json.at("language_compilation").items())
+        target.language_compilation[language] = compilation_from_json(compilation_json);
+      target_json.at("libraries_directories").get_to(target.libraries_directories);
+      target_json.at("link_libraries").get_to(target.link_libraries);
+      target_json.at("link_flags").get_to(target.link_flags);
       return target;
     }
 
-    auto extract_config(const std::string& name, const cmake::CodeModel::Configuration& codemodel_config) -> Configuration
-    {
-      Configuration config;
-      config.name = name;
-      for (auto [target_name, target_json] : codemodel_config.targets)
-      {
-        config.targets[target_name] = extract_target(target_json);
-      }
-      return config;
-    }
-
-    auto extract_dependencies(const cmake::CodeModel& codemodel) -> DependenciesInfo
+    auto dependencies_from_json(const json& dependencies_json) -> DependenciesInfo
     {
       DependenciesInfo dependencies;
-      for (auto [config_name, config] : codemodel.configs)
+      for(const auto& [config_name, config_json] : dependencies_json.at("configurations").items())
       {
-        dependencies.configurations[config_name] = extract_config(config_name, config);
+        Configuration config;
+        config_json.at("name").get_to(config.name);
+        for(const auto& [target_name, target_json] : config_json.at("targets").items())
+          config.targets[target_name] = target_from_json(target_json);
+        dependencies.configurations[config_name] = std::move(config);
       }
       return dependencies;
     }
 
+    auto modification_time(const path& file_path) -> std::int64_t
+    {
+      return butl::file_mtime(file_path).time_since_epoch().count();
+    }
 
-
-    auto differences(const Compilation& left, const Compilation& right) -> Compilation
+    // We avoid spawning CMake just to get its version: the path and modification time
+    // of the executable change whenever another CMake, or another version, is installed.
+    auto cmake_fingerprint() -> std::string
     {
-      Compilation different;
-      different.compilation_flags = difference(left.compilation_flags, right.compilation_flags);
-      different.defines = difference(left.defines, right.defines);
-      different.include_directories = difference(left.include_directories, right.include_directories);
-      different.source_files = difference(left.source_files, right.source_files);
-      return different;
+      const auto cmake_path = path(butl::process::path_search("cmake").effect_string());
+      return format("{}@{}", cmake_path.string(), modification_time(cmake_path));
     }
 
-    auto differences(const Target& left, const Target& right) -> Target
+    // Version of the CMake found in PATH, asked once per executable.
+    auto cmake_version() -> std::string
     {
-      Target different;
-      different.libraries_directories = difference(left.libraries_directories, right.libraries_directories);
-      different.link_flags = difference(left.link_flags, right.link_flags);
-      different.link_libraries = difference(left.link_libraries, right.link_libraries);
+      static std::mutex versions_mutex;
+      static std::map<std::string, std::string> versions; // By fingerprint.
+      const auto fingerprint = cmake_fingerprint();
+      const std::lock_guard<std::mutex> lock{ versions_mutex };
+      const auto found = versions.find(fingerprint);
+      if(found != versions.end())
+        return found->second;
+
+      std::string version;
+      cmake::run_cmake({ "--version" }, current_timeouts().configure, [&](std::string_view line){
+        constexpr std::string_view prefix = "cmake version ";
+        if(line.substr(0, prefix.size()) != prefix)
+          return false;
+        version = line.substr(prefix.size());
+        return true;
+      });
+      return versions[fingerprint] = version;
+    }
+
+    // The environment variables CMake reads to find and set up the compilers.
+    constexpr const char* toolchain_environment_variables[] = { "PATH", "CC", "CXX", "CFLAGS", "CXXFLAGS", "LDFLAGS" };
 
-      for(const auto& [ language_name, left_compilation ] : left.language_compilation)
+    auto toolchain_environment() -> json
+    {
+      json environment = json::object();
+      for(const auto variable : toolchain_environment_variables)
       {
-        const auto& right_compilation = right.language_compilation.find(language_name)->second;
-        different.language_compilation[language_name] = differences(left_compilation, right_compilation);
+        const auto value = std::getenv(variable);
+        environment[variable] = value ? value : "";
       }
+      return environment;
+    }
 
-      return different;
+    auto cache_key_inputs(const cmake::Configuration& config, const Options& options) -> json
+    {
+      json packages = json::array();
+      for(const auto& package : config.packages)
+        packages.push_back({ package.name, package.version, package.constraints });
+
+      json cmake_options = json::array();
+      for(const auto& option : config.options)
+        cmake_options.push_back({ option.first, option.second });
+
+      return {
+        { "format", cache_format_version },
+        { "cmake", cmake_fingerprint() },
+        { "generator", config.generator },
+        { "packages", packages },
+        { "targets", config.targets },
+        { "options", cmake_options },
+        { "args", config.args },
+        { "configurations", config.configurations },
+        { "code_format_to_inject_in_client", options.code_format_to_inject_in_client },
+        { "environment", toolchain_environment() }, // Another compiler, or other flags, give other results.
+      };
     }
 
-    auto differences(const Configuration& left, const Configuration& right) -> Configuration
+    auto cache_entry_path(const dir_path& cache_directory, const json& key_inputs) -> path
     {
-      Configuration different;
-      for(const auto& [target_name, left_target] : left.targets)
-      {
-        const auto& right_target = right.targets.find(target_name)->second;
-        static const std::regex to_remove(wyvern::target_prefix);
-        const auto dependency_name = std::regex_replace(target_name, to_remove, ""); // Deduce the dependency name by removing the of our test target
-        different.targets[dependency_name] = differences(left_target, right_target);
-      }
-      return different;
+      const auto key = butl::sha256{ key_inputs.dump() }.string();
+      return cache_directory / path(key + cache_entry_extension);
     }
 
-    auto compare_dependencies(const cmake::CodeModel& control_codemodel, const cmake::CodeModel& dependent_codemodel)
-        -> DependenciesInfo
+    // Returns the cached dependencies if the entry exists and none of the files CMake used
+    // to find the packages changed since it was stored.
+    auto load_cached_dependencies(const path& entry_path) -> std::optional<DependenciesInfo>
     {
-      log_codemodel("control", control_codemodel);
-      log_codemodel("project", dependent_codemodel);
+      TraceSpan span{ "load_cached_dependencies" };
+      span.arg("entry", entry_path.string()).arg("hit", false);
+      if(!butl::file_exists(entry_path))
+      {
+        log(LogLevel::info, "cache miss: {}", entry_path.string());
+        return {};
+      }
 
-      DependenciesInfo diff;
-      DependenciesInfo control = extract_dependencies(control_codemodel);
-      DependenciesInfo dependent = extract_dependencies(dependent_codemodel);
+      try
+      {
+        const auto entry = read_json_file(entry_path);
+        for(const auto& input : entry.at("inputs"))
+        {
+          const auto input_path = path(input.at("path").get<std::string>());
+          if(!butl::file_exists(input_path) || modification_time(input_path) != input.at("mtime").get<std::int64_t>())
+          {
+            log(LogLevel::info, "cache entry {} is outdated: {} changed", entry_path.string(), input_path.string());
+            return {};
+          }
+        }
 
-      for(const auto& [config_name, config] : dependent.configurations)
+        log(LogLevel::info, "cache hit: {}", entry_path.string());
+        span.arg("hit", true);
+        return dependencies_from_json(entry.at("dependencies"));
+      }
+      catch(const std::exception& error)
       {
-        diff.configurations[config_name] = differences(config, control.configurations[config_name]);
+        log(LogLevel::warning, "ignoring invalid cache entry {}: {}", entry_path.string(), error.what());
+        return {};
       }
-
-      return diff;
+    }
+
+    auto store_cached_dependencies(const path& entry_path, const json& key_inputs,
+                                   const std::vector<path>& input_files, const DependenciesInfo& dependencies) -> void
+    {
+      TraceSpan span{ "store_cached_dependencies" };
+      span.arg("entry", entry_path.string());
+      json inputs = json::array();
+      for(const auto& input_path : input_files)
+        inputs.push_back({ { "path", input_path.string() }, { "mtime", modification_time(input_path) } });
+
+      const json entry = {
+        { "key", key_inputs },
+        { "inputs", inputs },
+        { "dependencies", to_json(dependencies) },
+      };
+
+      create_directories(entry_path.directory());
+
+      // Write then rename, so that concurrent readers never see a partially written entry.
+      const auto temporary_path = path(format("{}.{}.tmp", entry_path.string(), random_int(0, 99999999)));
+      write_to_file(temporary_path, entry.dump(2));
+      butl::mvfile(temporary_path, entry_path, butl::cpflags::overwrite_content | butl::cpflags::overwrite_permissions);
+    }
+
+    // The control project does not depend on the packages nor the targets requested,
+    // so its extraction is shared by all the extractions with the same toolchain settings
+    // (CMake, generator, options, args and compiler environment variables):
+    // in this process and, when there is a cache directory, by the following processes.
+    std::mutex control_memo_mutex;
+    std::map<std::string, DependenciesInfo> control_memo; // Extracted control information, by cache key.
+
+    auto control_key_inputs(const cmake::Configuration& config) -> json
+    {
+      json cmake_options = json::array();
+      for(const auto& option : config.options)
+        cmake_options.push_back({ option.first, option.second });
+
+      return {
+        { "format", cache_format_version },
+        { "control", true },
+        { "cmake", cmake_fingerprint() },
+        { "generator", config.generator },
+        { "options", cmake_options },
+        { "args", config.args },
+        { "configurations", config.configurations },
+        { "environment", toolchain_environment() }, // Another compiler, or other flags, give other control information.
+      };
+    }
+
+    // Toolchain probes: configuring a new build directory starts with CMake detecting the system and the compilers,
+    // the slowest part of configuring our projects, and writing the results in CMakeFiles/<cmake-version>/.
+    // They only depend on the toolchain settings, so they are detected once, in a project of their own,
+    // and copied into the new build directories, whose configuration then reuses them.
+    constexpr auto toolchain_probes_directory_name = "toolchains";
+
+    auto toolchain_key_inputs(const cmake::Configuration& config) -> json
+    {
+      auto key_inputs = control_key_inputs(config);
+      key_inputs.erase("control");
+      key_inputs.erase("configurations"); // The toolchain is the same for all.
+      key_inputs["toolchain"] = true;
+      return key_inputs;
+    }
+
+    // Kept with the other results when caching, the extractions of this process share them otherwise.
+    auto toolchain_probes_directory(const Options& options) -> dir_path
+    {
+      if(!options.cache_directory.empty())
+        return options.cache_directory / dir_path(toolchain_probes_directory_name);
+      if(!options.work_directory.empty())
+        return options.work_directory / dir_path(toolchain_probes_directory_name);
+
+      static const scoped_temp_dir process_directory;
+      return process_directory.path() / dir_path(toolchain_probes_directory_name);
+    }
+
+    // Toolchains detected again by this process because of `Options::refresh_cache`: once is enough.
+    std::mutex refreshed_toolchains_mutex;
+    std::set<std::string> refreshed_toolchains;
+
+    // Returns the directory of the platform files of the toolchain, detecting it if it was not yet.
+    auto probe_toolchain(const cmake::Configuration& config, const Options& options) -> dir_path
+    {
+      const auto key = butl::sha256{ toolchain_key_inputs(config).dump() }.string().substr(0, 16);
+      const auto probes_path = toolchain_probes_directory(options);
+      create_directories(probes_path);
+      const FileLock probe_lock{ probes_path / path(format("{}.lock", key)) }; // Detected once, by one thread of one process.
+
+      const auto probe_path = (probes_path / dir_path(key)).normalize(true, true);
+      const auto build_path = probe_path / dir_path("build");
+      const auto result_path = probe_path / path("probe.json");
+      const auto platform_files_path = [&](const std::string& cmake_version){
+        return build_path / dir_path("CMakeFiles") / dir_path(cmake_version);
+      };
+
+      const bool is_refreshed = options.refresh_cache && [&]{
+        const std::lock_guard<std::mutex> lock{ refreshed_toolchains_mutex };
+        return refreshed_toolchains.insert(key).second;
+      }();
+      if(!is_refreshed && butl::file_exists(result_path))
+      {
+        const auto cmake_version = read_json_file(result_path).at("cmake_version").get<std::string>();
+        if(butl::dir_exists(platform_files_path(cmake_version)))
+          return platform_files_path(cmake_version);
+      }
+
+      TraceSpan span{ "probe_toolchain" };
+      log(LogLevel::info, "detecting the toolchain in {}", probe_path.string());
+      if(butl::dir_exists(build_path))
+        butl::rmdir_r(build_path); // From a previous detection, refreshed or interrupted.
+
+      const auto project_path = probe_path / dir_path("project");
+      create_directories(project_path);
+      write_file_if_changed(project_path / path("CMakeLists.txt"),
+        format("cmake_minimum_required(VERSION {})\n\nproject(wyvern_toolchain_probe)\n", cmake::minimum_cmake_version));
+      cmake::configure_project(project_path, build_path, config);
+
+      std::string cmake_version;
+      butl::path_search(path("*/"), [&](path entry_path, const std::string&, bool){
+        const auto name = dir_path(entry_path.string()).leaf().string();
+        if(!butl::file_exists(platform_files_path(name) / path("CMakeSystem.cmake")))
+          return true;
+        cmake_version = name;
+        return false;
+      }, build_path / dir_path("CMakeFiles"));
+
+      if(cmake_version.empty())
+        throw failure(format("CMake did not write the platform files in {}", build_path.string()));
+
+      write_to_file(result_path, json{ { "cmake_version", cmake_version } }.dump(2));
+      return platform_files_path(cmake_version);
+    }
+
+    // Copies the platform files to where CMake looks for them in the new build directory.
+    auto seed_platform_files(const dir_path& platform_files_path, const dir_path& build_path) -> void
+    {
+      const auto seeded_path = build_path / dir_path("CMakeFiles") / platform_files_path.leaf();
+      create_directories(seeded_path);
+      butl::path_search(path("*.cmake"), [&](path file_path, const std::string&, bool){
+        butl::cpfile(platform_files_path / file_path, seeded_path / file_path, butl::cpflags::overwrite_content);
+        return true;
+      }, platform_files_path);
+    }
+
+    // Everything a generated project, and what CMake makes of it, depends on.
+    auto project_key_inputs(const cmake::Configuration& config, cmake::cmakefile_mode mode, const Options& options) -> json
+    {
+      auto key_inputs = mode == cmake::cmakefile_mode::without_dependencies ? control_key_inputs(config) : cache_key_inputs(config, options);
+      key_inputs["validation"] = static_cast<int>(options.validation);
+      return key_inputs;
+    }
+
+    auto project_kind(cmake::cmakefile_mode mode) -> const char*
+    {
+      switch(mode)
+      {
+        case cmake::cmakefile_mode::without_dependencies: return "control";
+        case cmake::cmakefile_mode::with_dependencies: return "dependent";
+        case cmake::cmakefile_mode::with_usage_dumps: return "usage";
+        case cmake::cmakefile_mode::traced: return "traced";
+      }
+      return "unknown";
+    }
+
+    // Generates the project, configures it, builds it if validating, then calls `read_build_directory()`
+    // while the project still exists. `configure_args` and `consume_line` are only used to configure (see `configure_project()`).
+    auto configure_generated_project(const cmake::Configuration& config, cmake::cmakefile_mode mode, const Options& options,
+                                     const std::function<void(const dir_path& build_directory_path)>& read_build_directory,
+                                     const std::vector<std::string>& configure_args = {},
+                                     const OutputCapture::LineConsumer& consume_line = nullptr)
+        -> void
+    {
+      TraceSpan span{ "configure_generated_project" };
+      const auto kind = project_kind(mode);
+      span.arg("project", kind);
+      // step 1
+      // The names only depend on the inputs: a persistent project is found again by the extractions with the same inputs.
+      const auto key = butl::sha256{ project_key_inputs(config, mode, options).dump() }.string().substr(0, 16);
+      const auto project_name = format("wyvern_{}", key);
+      std::optional<scoped_temp_dir> temp_dir;
+      std::optional<FileLock> project_lock; // Other threads and processes can use the same persistent project.
+      dir_path project_path;
+      if(options.work_directory.empty())
+      {
+        temp_dir.emplace(options.keep_generated_projects);
+        project_path = temp_dir->path();
+      }
+      else
+      {
+        create_directories(options.work_directory);
+        project_path = (options.work_directory / dir_path(format("{}-{}", kind, key))).normalize(true, true);
+        project_lock.emplace(project_path.directory() / path(format("{}-{}.lock", kind, key)));
+        create_directories(project_path);
+      }
+      const auto targets = cmake::project_targets(config, mode);
+      cmake::create_cmake_project(project_path, project_name, config, targets, mode, options.validation, options.code_format_to_inject_in_client);
+
+      // step 2
+      const auto generator_name = config.generator.empty() ? std::string("default-generator") : normalize_name(config.generator);
+      const auto build_dir_name = format("build-{}", generator_name);
+      const auto build_dir_path = (project_path / dir_path(build_dir_name)).normalize(true, true);
+      const bool is_incremental = butl::file_exists(build_dir_path / path("CMakeCache.txt"));
+      span.arg("incremental", is_incremental);
+      if(is_incremental)
+        log(LogLevel::info, "reconfiguring {}", build_dir_path.string());
+      const bool is_codemodel_needed = mode == cmake::cmakefile_mode::without_dependencies || mode == cmake::cmakefile_mode::with_dependencies;
+      cmake::write_cmake_file_api_query(build_dir_path, is_codemodel_needed);
+
+      bool is_platform_detected = false;
+      if(!is_incremental && options.reuse_toolchain_detection)
+      {
+        // Only an optimization: if the detection fails, configuring the project does it again, and reports the errors.
+        try
+        {
+          seed_platform_files(probe_toolchain(config, options), build_dir_path);
+          is_platform_detected = true;
+        }
+        catch(const ExtractionCancelled&)
+        {
+          throw;
+        }
+        catch(const ExtractionTimeout&)
+        {
+          throw;
+        }
+        catch(const std::exception& error)
+        {
+          log(LogLevel::warning, "failed to reuse the toolchain detection: {}", error.what());
+        }
+      }
+      span.arg("toolchain_reused", is_platform_detected);
+      cmake::configure_project(project_path, build_dir_path, config, is_platform_detected, configure_args, consume_line);
+
+      // step 3
+      if(options.validation != Validation::none)
+      {
+        cmake::build_project(build_dir_path, cmake::validation_targets(targets, options.validation), options.max_jobs, config.configurations,
+                             config.generator, cmake_version());
+      }
+
+      // step 4
+      check_interruption();
+      read_build_directory(build_dir_path);
+    }
+
+    auto extract_codemodel(const cmake::Configuration& config, cmake::cmakefile_mode mode, Options options, ExtractionSession& session)
+        -> cmake::CodeModel
+    {
+      TraceSpan span{ "extract_codemodel" };
+      span.arg("project", project_kind(mode));
+      cmake::CodeModel codemodel;
+      configure_generated_project(config, mode, options, [&](const dir_path& build_dir_path){
+        codemodel = cmake::read_cmake_file_api_reply(build_dir_path, session.symbols, options.max_jobs);
+      });
+      return codemodel;
+    }
+
+    auto extract_control(const cmake::Configuration& config, const Options& options, ExtractionSession& session)
+      -> DependenciesInfo
+    {
+      const auto key_inputs = control_key_inputs(config);
+      const auto key = butl::sha256{ key_inputs.dump() }.string();
+      const auto entry_path = options.cache_directory.empty() ? path{} : cache_entry_path(options.cache_directory, key_inputs);
+
+      if(!options.refresh_cache)
+      {
+        {
+          const std::lock_guard<std::mutex> lock{ control_memo_mutex };
+          const auto found = control_memo.find(key);
+          if(found != control_memo.end())
+          {
+            log(LogLevel::info, "reusing control information extracted previously");
+            return found->second;
+          }
+        }
+
+        if(!entry_path.empty())
+        {
+          if(auto cached_control = load_cached_dependencies(entry_path))
+          {
+            const std::lock_guard<std::mutex> lock{ control_memo_mutex };
+            return control_memo[key] = std::move(*cached_control);
+          }
+        }
+      }
+
+      const auto control_codemodel = extract_codemodel(config, cmake::cmakefile_mode::without_dependencies, options, session);
+      log_codemodel("control", control_codemodel, session.symbols);
+      auto control = extract_dependencies(control_codemodel, session.symbols);
+
+      if(!entry_path.empty())
+        store_cached_dependencies(entry_path, key_inputs, control_codemodel.external_files, control);
+
+      const std::lock_guard<std::mutex> lock{ control_memo_mutex };
+      return control_memo[key] = std::move(control);
     }
   } // namespace
 
+  namespace
+  {
+    struct Extraction
+    {
+      DependenciesInfo dependencies;
+      std::vector<path> external_files; // Files (outside of CMake) that CMake used to find the packages.
+    };
+
+    auto extract_dependencies_with_cmake(const cmake::Configuration& config, const Options& options)
+      -> Extraction
+    {
+      // 1. Create a temporary cmake project with CMakeFiles.txt and an c++ source file.
+      //    It should have no dependencies at all, just one executable target (they would all
+      //    be the same). This is skipped if that control information was already extracted.
+      // 2. Invoke CMake for that project, creating a build directory (without the options
+      //    specified in the provided configuration?).
+      // 3. Invoke CMake file-api in the resulting build directory to extract and store
+      //    JSON information -> A.
+      log(LogLevel::info, "==== Extracting Control & Dependencies Information ====");
+      // Both projects are independent (different temporary directories), so when allowed
+      // the control project is extracted in the background while we extract the dependent one.
+      // Both projects share the session: values are interned in the same table, so that they
+      // are compared as integers, and everything but the results is released at once at the end.
+      ExtractionSession session;
+      const bool run_concurrently = options.max_jobs != 1;
+      auto control_extraction = std::async(run_concurrently ? std::launch::async : std::launch::deferred, [&, context = current_context()]{
+        const ScopedContext scoped_context{ context };
+        return extract_control(config, options, session);
+      });
+
+      // 4. Modify the CMakeLists.txt to add:
+      //    - `find_package()` calls for each packages of the configuration provided;
+      //    - each executable target should depend on one associated CMake target from the configuration.
+      // 5. Invoke CMake again to create a different build directory, using options/variables
+      //    from the configuration.
+      // 6. Invoke CMake file-api on that new configuration and extract and store the
+      //    JSON information -> B.
+      std::exception_ptr dependent_failure;
+      cmake::CodeModel dependent_codemodel;
+      try
+      {
+        dependent_codemodel = extract_codemodel(config, cmake::cmakefile_mode::with_dependencies, options, session);
+      }
+      catch(...)
+      {
+        dependent_failure = std::current_exception();
+      }
+
+      // Always wait for the control extraction, even if the dependent one failed, so that
+      // we never leave while CMake is still running in one of our temporary directories.
+      // The dependent failure is reported first as it is the most likely to be about the user's packages.
+      std::exception_ptr control_failure;
+      DependenciesInfo control;
+      try
+      {
+        control = control_extraction.get();
+      }
+      catch(...)
+      {
+        control_failure = std::current_exception();
+      }
+
+      if(dependent_failure)
+        std::rethrow_exception(dependent_failure);
+      if(control_failure)
+        std::rethrow_exception(control_failure);
+
+      // 7. Compare A and B, find what's in B that was not in B.
+      // Return the result of that comparison.
+      check_interruption();
+      log(LogLevel::info, "==== Comparing Control & Dependencies Information ====");
+      log_codemodel("project", dependent_codemodel, session.symbols);
+      auto dependencies = compare_dependencies(control, dependent_codemodel, session);
+      return { std::move(dependencies), dependent_codemodel.external_files };
+    }
+
+    // Only configures the project with the dependencies, in which CMake writes their usage requirements
+    // (see `Backend::generated_properties`): throws `unsupported`, with the reasons, if they would not be exact.
+    auto extract_dependencies_with_generated_properties(const cmake::Configuration& config, const Options& options)
+      -> Extraction
+    {
+      TraceSpan span{ "extract_dependencies_with_generated_properties" };
+      log(LogLevel::info, "==== Extracting Generated Usage Requirements ====");
+      Extraction extraction;
+      configure_generated_project(config, cmake::cmakefile_mode::with_usage_dumps, options, [&](const dir_path& build_dir_path){
+        extraction.dependencies = read_usage_dumps(build_dir_path);
+        extraction.external_files = cmake::read_cmake_files_reply(build_dir_path / dir_path(".cmake/api/v1/reply/"));
+      });
+      return extraction;
+    }
+
+    // The toolchain, as the extractions without a control project need it: for Linux, whose link lines they know.
+    auto linux_platform(const cmake::Configuration& config, const Options& options) -> Platform
+    {
+      Platform platform;
+      try
+      {
+        platform = read_platform(probe_toolchain(config, options));
+      }
+      catch(const ExtractionCancelled&)
+      {
+        throw;
+      }
+      catch(const ExtractionTimeout&)
+      {
+        throw;
+      }
+      catch(const ExtractionError& error)
+      {
+        throw unsupported(format("the toolchain could not be detected: {}", error.what()));
+      }
+      if(platform.system_name != "Linux")
+        throw unsupported(format("the system is {}", platform.system_name));
+      return platform;
+    }
+
+    // Value of a variable of the cache of a build directory, empty if it is not set.
+    auto cache_variable(const dir_path& build_dir_path, std::string_view name) -> std::string
+    {
+      const MappedFile cache{ build_dir_path / path("CMakeCache.txt") };
+      auto content = cache.content();
+      while(!content.empty())
+      {
+        const auto end = content.find('\n');
+        const auto line = content.substr(0, end);
+        content = end == std::string_view::npos ? std::string_view{} : content.substr(end + 1);
+
+        // `<name>:<type>=<value>`
+        if(line.size() > name.size() && line.substr(0, name.size()) == name && line[name.size()] == ':')
+        {
+          const auto separator = line.find('=');
+          return separator == std::string_view::npos ? std::string{} : std::string{ line.substr(separator + 1) };
+        }
+      }
+      return {};
+    }
+
+    // Only configures the project with the dependencies, tracing the commands of the packages' files to reconstruct
+    // their imported targets (see `Backend::trace`): throws `unsupported`, with the reasons, if they would not be exact.
+    auto extract_dependencies_with_trace(const cmake::Configuration& config, const Options& options)
+      -> Extraction
+    {
+      TraceSpan span{ "extract_dependencies_with_trace" };
+      log(LogLevel::info, "==== Extracting Traced Imported Targets ====");
+      for(const auto& arg : config.args)
+      {
+        if(arg.rfind("--trace", 0) == 0)
+          throw unsupported(format("CMake is passed {}", arg));
+      }
+      const auto platform = linux_platform(config, options);
+      if(compare_versions(platform.cmake_version, json_trace_minimum_cmake_version) < 0)
+        throw unsupported(format("CMake {} can't write the trace as JSON", platform.cmake_version));
+
+      std::vector<std::string> package_names;
+      for(const auto& package : config.packages)
+        package_names.push_back(package.name);
+      auto build_type = std::string{ std::getenv("CMAKE_BUILD_TYPE") ? std::getenv("CMAKE_BUILD_TYPE") : "" };
+      for(const auto& [name, value] : config.options)
+      {
+        if(name.substr(0, name.find(':')) == "CMAKE_BUILD_TYPE")
+          build_type = value;
+      }
+
+      TraceReader reader;
+      Extraction extraction;
+      configure_generated_project(config, cmake::cmakefile_mode::traced, options, [&](const dir_path& build_dir_path){
+        span.arg("trace_commands", reader.commands_read()).arg("trace_bytes", reader.bytes_read());
+        if(!cache_variable(build_dir_path, "CMAKE_CONFIGURATION_TYPES").empty())
+          throw unsupported("the generator has several configurations");
+        const auto configuration_name = cache_variable(build_dir_path, "CMAKE_BUILD_TYPE");
+
+        extraction.external_files = cmake::read_cmake_files_reply(build_dir_path / dir_path(".cmake/api/v1/reply/"));
+        reader.check_files(extraction.external_files);
+        auto& configuration = extraction.dependencies.configurations[configuration_name];
+        configuration.name = configuration_name;
+        for(const auto& target : config.targets)
+          configuration.targets[normalize_name(target)] = reader.usage_requirements(target, platform, configuration_name);
+      }, trace_arguments(package_names, build_type), [&](std::string_view line){
+        return reader.read_line(line);
+      });
+      return extraction;
+    }
+
+    // Where CMake's modules are, to know which packages it finds with them.
+    auto cmake_modules_directory(const Platform& platform) -> dir_path
+    {
+      auto cmake_path = path(butl::process::path_search("cmake").effect_string());
+      cmake_path.realize();
+      const auto version = platform.cmake_version.substr(0, platform.cmake_version.rfind('.'));
+      const auto modules_path = cmake_path.directory().directory() / dir_path("share") / dir_path(format("cmake-{}", version)) / dir_path("Modules");
+      if(!butl::dir_exists(modules_path))
+        throw unsupported(format("CMake's modules are not in {}", modules_path.string()));
+      return modules_path;
+    }
+
+    // Reads the packages' export files instead of running CMake on the generated projects, when it gives
+    // the same information (see `Options::read_export_files`): throws `unsupported`, with the reason, otherwise.
+    auto read_export_files(const cmake::Configuration& config, const Options& options)
+      -> Extraction
+    {
+      TraceSpan span{ "read_export_files" };
+      if(options.validation != Validation::none)
+        throw unsupported("the generated projects are built to validate the information");
+      if(!config.args.empty())
+        throw unsupported("arguments are passed to CMake");
+      const auto environment_generator = std::getenv("CMAKE_GENERATOR");
+      const auto generator = config.generator.empty() && environment_generator ? std::string{ environment_generator } : config.generator;
+      if(!generator.empty() && generator != "Unix Makefiles" && generator != "Ninja")
+        throw unsupported(format("the generator is {}", generator));
+
+      std::vector<dir_path> prefixes;
+      auto build_type = std::string{ std::getenv("CMAKE_BUILD_TYPE") ? std::getenv("CMAKE_BUILD_TYPE") : "" };
+      for(const auto& [name, value] : config.options)
+      {
+        const auto variable = name.substr(0, name.find(':'));
+        if(variable == "CMAKE_BUILD_TYPE")
+        {
+          build_type = value;
+          continue;
+        }
+        if(variable != "CMAKE_PREFIX_PATH")
+          throw unsupported(format("{} is set", variable));
+        std::istringstream prefixes_list{ value };
+        for(std::string prefix; std::getline(prefixes_list, prefix, ';');)
+        {
+          if(prefix.empty())
+            continue;
+          if(!dir_path(prefix).absolute())
+            throw unsupported(format("{} is a relative prefix", prefix));
+          prefixes.push_back(dir_path(prefix).normalize());
+        }
+      }
+
+      const auto platform = linux_platform(config, options);
+      const auto modules_path = cmake_modules_directory(platform);
+
+      // Every package is tried, so that all the ones needing CMake are reported.
+      ExportFilesReader reader{ platform };
+      std::vector<std::string> packages_needing_cmake;
+      for(const auto& package : config.packages)
+      {
+        check_interruption();
+        try
+        {
+          if(!package.version.empty())
+            throw unsupported("a version is required");
+          bool is_config_mode = false;
+          for(const auto& constraint : package.constraints)
+          {
+            if(constraint != "CONFIG" && constraint != "NO_MODULE")
+              throw unsupported(format("{} is required", constraint));
+            is_config_mode = true;
+          }
+
+          const auto configuration_file = find_package_configuration_file(package.name, prefixes, is_config_mode ? dir_path{} : modules_path, platform);
+          reader.read_package(package.name, configuration_file);
+          log(LogLevel::info, "package {} read from {}", package.name, configuration_file.string());
+        }
+        catch(const unsupported& reason)
+        {
+          log(LogLevel::info, "package {} needs CMake: {}", package.name, reason.what());
+          packages_needing_cmake.push_back(package.name);
+        }
+      }
+      span.arg("packages_read", config.packages.size() - packages_needing_cmake.size()).arg("packages_needing_cmake", packages_needing_cmake.size());
+      if(!packages_needing_cmake.empty())
+        throw unsupported(format("packages {} need CMake", fmt::join(packages_needing_cmake, ", ")));
+
+      DependenciesInfo dependencies;
+      auto& configuration = dependencies.configurations[build_type];
+      configuration.name = build_type;
+      for(const auto& target : config.targets)
+        configuration.targets[normalize_name(target)] = reader.usage_requirements(target, build_type);
+      return { std::move(dependencies), reader.files_read() };
+    }
+
+    // The engines extracting the information with CMake (see `Backend`): only the diff one extracts it
+    // whatever the packages, the others throw `unsupported` when they could not tell exactly the same.
+    using ExtractionEngine = Extraction (*)(const cmake::Configuration& config, const Options& options);
+
+    auto extraction_engine(Backend backend) -> ExtractionEngine
+    {
+      switch(backend)
+      {
+        case Backend::diff: return extract_dependencies_with_cmake;
+        case Backend::generated_properties: return extract_dependencies_with_generated_properties;
+        case Backend::trace: return extract_dependencies_with_trace;
+      }
+      return extract_dependencies_with_cmake;
+    }
+
+    // Extracts from one configure of the generated projects: of all the configurations if the generator writes several.
+    auto extract_dependencies_once(const cmake::Configuration& config, const Options& options)
+      -> Extraction
+    {
+      if(options.read_export_files)
+      {
+        try
+        {
+          auto extraction = read_export_files(config, options);
+          log(LogLevel::info, "read the export files of all the packages, CMake was not run");
+          return extraction;
+        }
+        catch(const unsupported& reason)
+        {
+          log(LogLevel::info, "extracting with CMake: {}", reason.what());
+        }
+      }
+      if(options.backend != Backend::diff)
+      {
+        try
+        {
+          return extraction_engine(options.backend)(config, options);
+        }
+        catch(const unsupported& reason)
+        {
+          log(LogLevel::info, "extracting with the control project: {}", reason.what());
+        }
+      }
+      return extract_dependencies_with_cmake(config, options);
+    }
+
+    // The configuration to extract all the requested configurations from one configure, if the generator allows it:
+    // the generator of the configuration, or "Ninja Multi-Config" when none is set and CMake and ninja support it.
+    auto multi_config_configuration(const cmake::Configuration& config) -> std::optional<cmake::Configuration>
+    {
+      const auto environment_generator = std::getenv("CMAKE_GENERATOR");
+      const auto generator = config.generator.empty() && environment_generator ? std::string{ environment_generator } : config.generator;
+      if(!generator.empty())
+      {
+        if(!cmake::is_multi_config_generator(generator))
+          return {};
+        return config;
+      }
+
+      if(compare_versions(cmake_version(), cmake::ninja_multi_config_minimum_cmake_version) < 0 || butl::process::try_path_search("ninja", true).empty())
+        return {};
+      auto multi_config = config;
+      multi_config.generator = "Ninja Multi-Config";
+      return multi_config;
+    }
+
+    auto extract_dependencies_uncached(const cmake::Configuration& config, const Options& options)
+      -> Extraction
+    {
+      if(config.configurations.empty())
+        return extract_dependencies_once(config, options);
+      if(const auto multi_config = multi_config_configuration(config))
+        return extract_dependencies_once(*multi_config, options);
+
+      // The generator only writes one configuration: one configure each, merged.
+      log(LogLevel::info, "extracting the configurations {} separately", fmt::join(config.configurations, ", "));
+      std::vector<Extraction> extractions(config.configurations.size());
+      for_each_index_concurrently(config.configurations.size(), options.max_jobs, [&](std::size_t configuration_idx){
+        auto single_config = config;
+        single_config.configurations.clear();
+        single_config.options.push_back({ "CMAKE_BUILD_TYPE", config.configurations[configuration_idx] });
+        extractions[configuration_idx] = extract_dependencies_once(single_config, options);
+      });
+
+      Extraction merged;
+      for(auto& extraction : extractions)
+      {
+        merged.dependencies.configurations.merge(extraction.dependencies.configurations);
+        append(merged.external_files, std::move(extraction.external_files));
+      }
+      std::sort(merged.external_files.begin(), merged.external_files.end());
+      merged.external_files.erase(std::unique(merged.external_files.begin(), merged.external_files.end()), merged.external_files.end());
+      return merged;
+    }
+
+    auto extract_dependencies_cached(const cmake::Configuration& config, const Options& options)
+      -> DependenciesInfo
+    {
+      if(options.cache_directory.empty())
+        return extract_dependencies_uncached(config, options).dependencies;
+
+      const auto key_inputs = cache_key_inputs(config, options);
+      const auto entry_path = cache_entry_path(options.cache_directory, key_inputs);
+      if(!options.refresh_cache)
+      {
+        if(auto cached_dependencies = load_cached_dependencies(entry_path))
+          return std::move(*cached_dependencies);
+      }
+
+      auto extraction = extract_dependencies_uncached(config, options);
+      store_cached_dependencies(entry_path, key_inputs, extraction.external_files, extraction.dependencies);
+      return std::move(extraction.dependencies);
+    }
+
+    // Configurations can be extracted from the same generated projects if they use the same
+    // CMake settings and don't require different versions of the same package.
+    auto are_compatible(const cmake::Configuration& left, const cmake::Configuration& right) -> bool
+    {
+      if(left.generator != right.generator || left.options != right.options || left.args != right.args
+         || left.configurations != right.configurations)
+        return false;
+
+      for(const auto& left_package : left.packages)
+      {
+        for(const auto& right_package : right.packages)
+        {
+          if(left_package.name == right_package.name
+          && (left_package.version != right_package.version || left_package.constraints != right_package.constraints))
+            return false;
+        }
+      }
+      return true;
+    }
+
+    auto merge_into(cmake::Configuration& merged, const cmake::Configuration& config) -> void
+    {
+      for(const auto& package : config.packages)
+      {
+        const auto is_same_package = [&](const cmake::Package& merged_package){ return merged_package.name == package.name; };
+        if(std::none_of(merged.packages.begin(), merged.packages.end(), is_same_package))
+          merged.packages.push_back(package);
+      }
+
+      for(const auto& target : config.targets)
+      {
+        if(std::find(merged.targets.begin(), merged.targets.end(), target) == merged.targets.end())
+          merged.targets.push_back(target);
+      }
+    }
+
+    struct ExtractionGroup
+    {
+      cmake::Configuration merged_config;
+      std::vector<std::size_t> requests; // Index of the configurations merged in this group.
+    };
+
+    auto group_compatible_configurations(const std::vector<cmake::Configuration>& configs)
+      -> std::vector<ExtractionGroup>
+    {
+      std::vector<ExtractionGroup> groups;
+      for(std::size_t config_idx = 0; config_idx < configs.size(); ++config_idx)
+      {
+        const auto& config = configs[config_idx];
+        auto group = std::find_if(groups.begin(), groups.end(), [&](const ExtractionGroup& group){
+          return are_compatible(group.merged_config, config);
+        });
+
+        if(group == groups.end())
+        {
+          groups.push_back({ config, { config_idx } });
+          continue;
+        }
+
+        merge_into(group->merged_config, config);
+        group->requests.push_back(config_idx);
+      }
+      return groups;
+    }
+
+    // Keeps only the requested targets from the dependencies extracted for a group.
+    auto select_targets(const DependenciesInfo& group_dependencies, const std::vector<std::string>& targets)
+      -> DependenciesInfo
+    {
+      DependenciesInfo dependencies;
+      for(const auto& [config_name, group_config] : group_dependencies.configurations)
+      {
+        auto& config = dependencies.configurations[config_name];
+        config.name = group_config.name;
+        for(const auto& target : targets)
+        {
+          const auto found = group_config.targets.find(normalize_name(target));
+          if(found != group_config.targets.end())
+            config.targets.insert(*found);
+        }
+      }
+      return dependencies;
+    }
+
+    // Whether one of the errors CMake printed was raised by a `find_package()` call, directly or from the files
+    // it reads (in its call stack): CMake fails the same way whatever the targets requested. Warnings are ignored.
+    auto is_package_failure(std::string_view output) -> bool
+    {
+      bool is_in_error = false;
+      while(!output.empty())
+      {
+        const auto end = output.find('\n');
+        const auto line = output.substr(0, end);
+        output = end == std::string_view::npos ? std::string_view{} : output.substr(end + 1);
+
+        if(line.empty() || line.front() == ' ' || line.rfind("Call Stack", 0) == 0)
+        {
+          if(is_in_error && line.find("(find_package)") != std::string_view::npos)
+            return true;
+          continue;
+        }
+        is_in_error = line.rfind("CMake Error at ", 0) == 0;
+        if(is_in_error && line.find("(find_package)") != std::string_view::npos)
+          return true;
+      }
+      return false;
+    }
+
+  } // namespace
+
   auto extract_dependencies(const cmake::Configuration& config, Options options)
     -> DependenciesInfo
   {
-    bool was_logging_enabled = enable_logging(options.enable_logging);
+    CallContext context{ options };
+    const ScopedContext scoped_context{ &context };
+    TraceSpan span{ "extract_dependencies" };
+    span.arg("packages", config.packages.size()).arg("targets", config.targets.size());
 
-    log() << "Begin cmake dependencies extraction" << " now";
+    log(LogLevel::info, "Begin cmake dependencies extraction now");
 
+    const auto dependencies = extract_dependencies_cached(config, options);
 
-    // 1. Create a temporary cmake project with CMakeFiles.txt and an c++ source file.
-    //    It should have no dependencies at all, just as many executable targets as
-    //    the number of targets in the provided configuration.
-    // 2. Invoke CMake for that project, creating a build directory (without the options
-    //    specified in the provided configuration?).
-    // 3. Invoke CMake file-api in the resulting build directory to extract and store
-    //    JSON information -> A.
-    log() << "==== Extracting Control Information ====";
-    const auto control_codemodel = extract_codemodel(config, cmake::cmakefile_mode::without_dependencies, options);
+    log(LogLevel::info, "End cmake dependencies extraction here");
 
-    // 4. Modify the CMakeLists.txt to add:
-    //    - `find_package()` calls for each packages of the configuration provided;
-    //    - each executable target should depend on one associated CMake target from the configuration.
-    // 5. Invoke CMake again to create a different build directory, using options/variables
-    //    from the configuration.
-    // 6. Invoke CMake file-api on that new configuration and extract and store the
-    //    JSON information -> B.
-    log() << "==== Extracting Dependencies Information ====";
-    const auto dependent_codemodel = extract_codemodel(config, cmake::cmakefile_mode::with_dependencies, options);
+    return dependencies;
+  }
 
-    // 7. Compare A and B, find what's in B that was not in B.
-    // Return the result of that comparison.
-    log() << "==== Comparing Control & Dependencies Information ====";
-    const auto dependencies = compare_dependencies(control_codemodel, dependent_codemodel);
+  auto extract_dependencies_async(const cmake::Configuration& config, Options options)
+    -> std::future<DependenciesInfo>
+  {
+    return std::async(std::launch::async, [config, options = std::move(options)]{
+      return extract_dependencies(config, options);
+    });
+  }
 
-    log() << "End cmake dependencies extraction" << " here";
+  auto extract_dependencies_batch(const std::vector<cmake::Configuration>& configs, Options options)
+    -> std::vector<BatchResult>
+  {
+    CallContext context{ options };
+    const ScopedContext scoped_context{ &context };
+    TraceSpan span{ "extract_dependencies_batch" };
+    span.arg("configurations", configs.size());
+
+    log(LogLevel::info, "Begin batch cmake dependencies extraction of {} configurations", configs.size());
+
+    const auto groups = group_compatible_configurations(configs);
+    log(LogLevel::info, "Configurations merged in {} groups", groups.size());
+    span.arg("groups", groups.size());
+
+    // A failing group only fails its own configurations.
+    std::vector<BatchResult> results(configs.size());
+    for_each_index_concurrently(groups.size(), options.max_jobs, [&](std::size_t group_idx){
+      const auto& group = groups[group_idx];
+      try
+      {
+        const auto group_dependencies = extract_dependencies_cached(group.merged_config, options);
+        for(const auto config_idx : group.requests)
+        {
+          results[config_idx].dependencies = select_targets(group_dependencies, configs[config_idx].targets);
+        }
+      }
+      catch(const ExtractionCancelled&)
+      {
+        throw;
+      }
+      catch(const ExtractionTimeout&)
+      {
+        throw;
+      }
+      catch(const ExtractionError& error)
+      {
+        log(LogLevel::warning, "extraction of {} configurations failed: {}", group.requests.size(), error.what());
+        for(const auto config_idx : group.requests)
+        {
+          results[config_idx].error = error.what();
+        }
+      }
+    });
 
-    enable_logging(was_logging_enabled);
+    const auto failures_count = std::count_if(results.begin(), results.end(), [](const BatchResult& result){ return !result.error.empty(); });
+    span.arg("failed_configurations", failures_count);
+    log(LogLevel::info, "End batch cmake dependencies extraction: {} of {} configurations extracted", configs.size() - failures_count, configs.size());
 
-    return dependencies;
+    return results;
+  }
+
+  auto extract_dependencies_sharded(const cmake::Configuration& config, Options options)
+    -> PartialDependenciesInfo
+  {
+    CallContext context{ options };
+    const ScopedContext scoped_context{ &context };
+    TraceSpan span{ "extract_dependencies_sharded" };
+    span.arg("packages", config.packages.size()).arg("targets", config.targets.size());
+
+    log(LogLevel::info, "Begin sharded cmake dependencies extraction now");
+
+    std::vector<std::string> targets;
+    for(const auto& target : config.targets)
+    {
+      if(std::find(targets.begin(), targets.end(), target) == targets.end())
+        targets.push_back(target);
+    }
+    const auto shard_size = std::max<std::size_t>(options.shard_size, 1);
+    std::vector<std::vector<std::string>> shards;
+    for(std::size_t first_idx = 0; first_idx < targets.size(); first_idx += shard_size)
+    {
+      const auto last_idx = std::min(first_idx + shard_size, targets.size());
+      shards.emplace_back(targets.begin() + first_idx, targets.begin() + last_idx);
+    }
+    span.arg("shards", shards.size());
+
+    // One pool of threads takes the shards in order. The halves of the failing ones are queued after them,
+    // once all of them were extracted or failed.
+    struct Shard
+    {
+      std::vector<std::string> targets;
+      bool is_split = false; // Half of a failing shard.
+    };
+    std::deque<Shard> queue;
+    for(auto& shard : shards)
+      queue.push_back({ std::move(shard) });
+    std::mutex queue_mutex;
+    std::condition_variable queue_changed;
+    std::size_t running_count = 0;
+    bool is_stopped = false; // No more shards are extracted.
+    std::exception_ptr interruption; // Why the call must stop, rethrown once the threads are done.
+    std::size_t decided_shards_count = 0; // Of the initial shards.
+    std::vector<std::pair<Shard, std::string>> failed_shards; // Initial shards, split once all of them are decided.
+    bool is_any_extracted = false;
+    PartialDependenciesInfo result;
+    std::size_t extractions_count = 0;
+
+    // Called with the queue locked.
+    const auto fail_remaining_targets = [&](const std::string& error){
+      for(const auto& target : targets)
+        result.targets.try_emplace(target, TargetStatus{ false, error });
+      queue.clear();
+      is_stopped = true;
+    };
+    const auto split_shard = [&](const Shard& shard, const std::string& error){
+      if(shard.targets.size() == 1)
+      {
+        log(LogLevel::warning, "target {} could not be extracted: {}", shard.targets.front(), error);
+        result.targets[shard.targets.front()] = { false, error };
+        return;
+      }
+
+      log(LogLevel::info, "extraction of {} targets failed, splitting them: {}", shard.targets.size(), error);
+      const auto middle = shard.targets.begin() + static_cast<std::ptrdiff_t>(shard.targets.size() / 2);
+      queue.push_back({ { shard.targets.begin(), middle }, true });
+      queue.push_back({ { middle, shard.targets.end() }, true });
+    };
+    // Once every initial shard is decided: if none could be extracted, the targets are not to blame.
+    const auto split_failed_shards = [&]{
+      if(is_stopped || decided_shards_count != shards.size())
+        return;
+      if(shards.size() > 1 && failed_shards.size() == shards.size() && !is_any_extracted)
+      {
+        log(LogLevel::warning, "none of the targets can be extracted: {}", failed_shards.front().second);
+        fail_remaining_targets(failed_shards.front().second);
+        return;
+      }
+      for(const auto& [shard, error] : failed_shards)
+        split_shard(shard, error);
+      failed_shards.clear();
+    };
+    const auto record_failure = [&](const Shard& shard, const ExtractionError& error){
+      if(is_stopped)
+        return;
+
+      // CMake fails the same way whatever the targets when it can't find a package: splitting would not isolate anything.
+      const auto cmake_error = dynamic_cast<const CMakeError*>(&error);
+      if(cmake_error && is_package_failure(cmake_error->output))
+      {
+        log(LogLevel::warning, "none of the targets can be extracted: {}", error.what());
+        fail_remaining_targets(error.what());
+        return;
+      }
+
+      if(shard.is_split)
+      {
+        split_shard(shard, error.what());
+        return;
+      }
+      ++decided_shards_count;
+      failed_shards.emplace_back(shard, error.what());
+      split_failed_shards();
+    };
+
+    const auto jobs = options.max_jobs == 0 ? std::max(1u, std::thread::hardware_concurrency()) : options.max_jobs;
+    const auto workers_count = std::min<std::size_t>(jobs, targets.size());
+    for_each_index_concurrently(workers_count, static_cast<unsigned>(workers_count), [&](std::size_t){
+      std::unique_lock<std::mutex> lock{ queue_mutex };
+      while(true)
+      {
+        queue_changed.wait(lock, [&]{ return is_stopped || !queue.empty() || running_count == 0; });
+        if(is_stopped || queue.empty())
+          return;
+
+        const auto shard = std::move(queue.front());
+        queue.pop_front();
+        ++running_count;
+        ++extractions_count;
+        lock.unlock();
+
+        auto shard_config = config;
+        shard_config.targets = shard.targets;
+        std::exception_ptr failure;
+        DependenciesInfo dependencies;
+        try
+        {
+          dependencies = extract_dependencies_cached(shard_config, options);
+        }
+        catch(...)
+        {
+          failure = std::current_exception();
+        }
+
+        lock.lock();
+        --running_count;
+        try
+        {
+          if(failure)
+            std::rethrow_exception(failure);
+
+          // Even once stopped: the targets of the shards still running are extracted.
+          is_any_extracted = true;
+          if(!shard.is_split)
+          {
+            ++decided_shards_count;
+            split_failed_shards();
+          }
+          for(auto& [config_name, shard_configuration] : dependencies.configurations)
+          {
+            auto& configuration = result.dependencies.configurations[config_name];
+            configuration.name = shard_configuration.name;
+            configuration.targets.merge(shard_configuration.targets);
+          }
+          for(const auto& target : shard.targets)
+            result.targets[target] = { true, {} };
+        }
+        catch(const ExtractionCancelled&)
+        {
+          interruption = failure;
+          is_stopped = true;
+        }
+        catch(const ExtractionTimeout&)
+        {
+          interruption = failure;
+          is_stopped = true;
+        }
+        catch(const ExtractionError& error)
+        {
+          record_failure(shard, error);
+        }
+        catch(...)
+        {
+          interruption = failure;
+          is_stopped = true;
+        }
+        queue_changed.notify_all();
+      }
+    });
+    if(interruption)
+      std::rethrow_exception(interruption);
+
+    const auto failures_count = std::count_if(result.targets.begin(), result.targets.end(), [](const auto& target){ return !target.second.is_extracted; });
+    span.arg("extractions", extractions_count).arg("failed_targets", failures_count);
+    log(LogLevel::info, "End sharded cmake dependencies extraction here: {} of {} targets extracted, in {} extractions",
+        targets.size() - failures_count, targets.size(), extractions_count);
+
+    return result;
+  }
+
+  void clear_cache(const dir_path& cache_directory)
+  {
+    if(!butl::dir_exists(cache_directory))
+      return;
+
+    std::vector<path> entries;
+    butl::path_search(path(format("*{}", cache_entry_extension)), [&](path entry_path, const std::string&, bool){
+      entries.push_back(cache_directory / entry_path);
+      return true;
+    }, cache_directory);
+
+    for(const auto& entry_path : entries)
+    {
+      butl::try_rmfile(entry_path);
+      log(LogLevel::info, "removed cache entry {}", entry_path.string());
+    }
+
+    const auto toolchain_probes_path = cache_directory / dir_path(toolchain_probes_directory_name);
+    if(butl::dir_exists(toolchain_probes_path))
+    {
+      butl::rmdir_r(toolchain_probes_path);
+      log(LogLevel::info, "removed toolchain probes {}", toolchain_probes_path.string());
+    }
   }
 } // namespace wyvern
@@ -4,7 +4,14 @@
 #include <utility>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <functional>
 #include <map>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
 
 #include <libbutl/path.mxx>
 
@@ -28,6 +35,10 @@ namespace wyvern::cmake {
     std::vector<std::string> targets; // Qualified names of CMake targets to extract information from.
     std::vector<Option> options; // CMake options and variables to pass to CMake on invokation.
     std::vector<std::string> args; // Additional arguments
+    std::vector<std::string> configurations; // Build types to extract (Debug, Release...), the generator's default if empty.
+                                             // All come from one configure with a generator writing several configurations
+                                             // ("Ninja Multi-Config" if no generator is set and ninja is found), otherwise
+                                             // from one configure each (see `CMAKE_CONFIGURATION_TYPES`, `CMAKE_BUILD_TYPE`).
   };
 
   LIBWYVERN_SYMEXPORT
@@ -69,16 +80,184 @@ namespace wyvern
   LIBWYVERN_SYMEXPORT
   std::ostream& operator<<(std::ostream& out, const DependenciesInfo& deps);
 
+  // What became of a requested target (see `extract_dependencies_sharded()`).
+  struct TargetStatus
+  {
+    bool is_extracted = false;
+    std::string error; // Why it could not be extracted, when extracting it alone. Empty if extracted.
+  };
+
+  struct PartialDependenciesInfo
+  {
+    DependenciesInfo dependencies; // Of the extracted targets.
+    std::map<std::string, TargetStatus> targets; // By requested name.
+  };
+
+  // What became of a configuration given to `extract_dependencies_batch()`.
+  struct BatchResult
+  {
+    DependenciesInfo dependencies; // Empty if it could not be extracted.
+    std::string error; // Why the configurations extracted with it could not be. Empty if extracted.
+  };
+
+  // How much of the generated projects is built to check that the extracted information works.
+  // The information is complete once the projects are configured, building only validates it.
+  enum class Validation
+  {
+    none,     // Only configure the projects.
+    compile,  // Compile the generated sources: checks the compilation flags, include directories and defines.
+    link,     // Compile and link the generated executables: also checks the libraries and link flags.
+  };
+
+  // How the information is obtained from CMake.
+  enum class Backend
+  {
+    diff,                   // Configure a project with the dependencies and a control project without them, and compare
+                            // what CMake's file-api reports for their targets.
+    generated_properties,   // Only configure the project with the dependencies, in which CMake evaluates their usage requirements
+                            // (and those of the targets they link to) into generated files (see `file(GENERATE)`).
+                            // Extracts with `diff` when the files could not tell exactly the same (logged, info level).
+    trace,                  // Only configure the project with the dependencies, with CMake tracing the commands of the packages' files
+                            // (CMake 3.17 or later): their imported targets are reconstructed from the trace, read as CMake writes it.
+                            // Extracts with `diff` when the trace could not tell exactly the same (logged, info level).
+  };
+
+  // Thrown when an extraction fails (CMake failed, invalid replies, files that can't be written...).
+  struct LIBWYVERN_SYMEXPORT ExtractionError : std::runtime_error
+  {
+    using std::runtime_error::runtime_error;
+  };
+
+  // Thrown when a CMake process fails. The message ends with what it printed last.
+  struct LIBWYVERN_SYMEXPORT CMakeError : ExtractionError
+  {
+    std::string output; // Latest output (standard output and error) of the process, see `Options::cmake_output_tail_size`.
+
+    CMakeError(const std::string& message, std::string output)
+      : ExtractionError(output.empty() ? message : message + "\n" + output)
+      , output(std::move(output))
+    {}
+  };
+
+  // Thrown when an extraction is stopped through its cancellation token.
+  struct LIBWYVERN_SYMEXPORT ExtractionCancelled : ExtractionError
+  {
+    using ExtractionError::ExtractionError;
+  };
+
+  // Thrown when an extraction, or one of its phases, takes longer than allowed (see `Options::timeouts`).
+  struct LIBWYVERN_SYMEXPORT ExtractionTimeout : ExtractionError
+  {
+    using ExtractionError::ExtractionError;
+  };
+
+  // Lets any thread stop the extractions it was given to (see `Options::cancellation`): the running CMake
+  // processes are killed, the temporary directories removed, and the extractions throw `ExtractionCancelled`.
+  // Copies share the same state.
+  class LIBWYVERN_SYMEXPORT CancellationToken
+  {
+    std::shared_ptr<std::atomic<bool>> cancelled = std::make_shared<std::atomic<bool>>(false);
+
+  public:
+    void cancel() { *cancelled = true; }
+    bool is_cancelled() const { return *cancelled; }
+  };
+
+  // Maximum durations, no limit if zero.
+  struct Timeouts
+  {
+    std::chrono::milliseconds configure{ 0 }; // Each configuration of a generated project by CMake.
+    std::chrono::milliseconds build{ 0 };     // Each build of a generated project (see `Options::validation`).
+    std::chrono::milliseconds total{ 0 };     // The whole call.
+  };
+
+  // Importance of a logged message: only the messages of the enabled level or more important are logged.
+  enum class LogLevel
+  {
+    error,
+    warning,
+    info,     // Progress of the extraction: phases, CMake invocations, use of the cache.
+    debug,    // Details: files written, temporary directories, content of CMake's replies.
+  };
+
+  // Receives the logged messages, in order, from a background thread: logging never waits for it
+  // unless it is far behind. It must not log nor throw (exceptions are ignored).
+  using LogSink = std::function<void(LogLevel level, std::string_view message)>;
+
   struct Options
   {
     bool keep_generated_projects = false;
     std::string code_format_to_inject_in_client;
     bool enable_logging = false;
+    LogLevel log_level = LogLevel::debug; // Least important messages logged when logging is enabled.
+    LogSink log_sink; // Receives the messages of this call instead of the process-wide sink (see `set_log_sink()`) if not empty.
+    Validation validation = Validation::link;
+    unsigned max_jobs = 0; // Maximum number of CMake processes run concurrently by a call, 0 means no limit. Use 1 to extract sequentially.
+                           // A build of a generated project counts as one, its build-system runs at most as many jobs (see `validation`;
+                           // before CMake 3.12, only make and ninja are told the number of jobs).
+                           // Also bounds the threads reading CMake's replies (hardware concurrency if 0).
+    butl::dir_path cache_directory; // Where extraction results (and control project information) are cached between calls. No caching if empty.
+                                    // Control project information is always reused in the same process.
+    butl::dir_path work_directory; // Where the generated projects are kept, named after their inputs, to be reconfigured incrementally
+                                   // (compiler detection and checks are not done again) by the extractions with the same inputs.
+                                   // Can be shared by concurrent processes. Temporary directories if empty.
+    bool reuse_toolchain_detection = true; // Detect the system and compilers once per toolchain (same CMake, generator, options, args
+                                           // and compiler environment variables) instead of in each generated project.
+                                           // Kept in the cache directory, or the work directory, for the next calls.
+    bool read_export_files = false; // Without validation, read the packages' configuration and export files instead of running CMake
+                                    // on the generated projects, when they only use what a small CMake interpreter evaluates exactly
+                                    // (imported targets, their usage requirements...). Otherwise, extracts with CMake: the reasons,
+                                    // and which packages were read, are logged (info level).
+    Backend backend = Backend::diff;
+    std::size_t shard_size = 8; // Targets extracted together by `extract_dependencies_sharded()`, at least 1.
+    bool refresh_cache = false; // Ignore cached and previously extracted information, extract again and replace them in the cache.
+    CancellationToken cancellation; // Keep a copy to cancel the extraction from another thread.
+    Timeouts timeouts; // The CMake processes running late are killed and the extraction throws `ExtractionTimeout`.
+    butl::path trace_file; // Where to write the timing of the extraction's phases (CMake invocations, reading replies, comparison...)
+                           // as Chrome trace-event JSON, to load in chrome://tracing or Perfetto. No tracing if empty.
+    std::size_t cmake_output_tail_size = 16 * 1024; // Bytes of the latest output of each CMake process kept for errors and traces.
+    std::function<void(std::string_view line)> cmake_output_handler; // Receives each line CMake prints, from a thread reading it
+                                                                      // (concurrently for concurrent CMake processes). They are also logged (debug level).
+                                                                      // The trace of `Backend::trace` is not passed, nor logged.
   };
 
+  // Thread-safety: extractions can be called concurrently from any threads. Each call only follows its own
+  // options (logging, tracing...): it doesn't change nor depend on the process-wide settings, its state is its own.
+  // Calls only share, safely:
+  //  - the control information extracted in the process, reused when the toolchain settings are the same;
+  //  - the cache directory, whose entries are replaced atomically;
+  //  - the delivery of logged messages (see `set_log_sink()`).
   LIBWYVERN_SYMEXPORT
   DependenciesInfo extract_dependencies(const cmake::Configuration& config, Options options = {});
 
+  // Same as `extract_dependencies()`, in another thread, so that the caller can do other work meanwhile.
+  // Like any `std::async()` future, the returned one waits for the end of the extraction when destroyed:
+  // cancel it first (see `Options::cancellation`) to abandon it without waiting for CMake.
+  LIBWYVERN_SYMEXPORT
+  std::future<DependenciesInfo> extract_dependencies_async(const cmake::Configuration& config, Options options = {});
+
+  // Extracts the dependencies of each configuration, in the same order.
+  // Compatible configurations (same generator, options and args, no conflicting package requirements)
+  // are merged and extracted together from the same generated projects, the others are extracted
+  // concurrently (see `Options::max_jobs`). A failing extraction only fails the configurations merged together.
+  // Only throws if the call must stop (`ExtractionCancelled`, `ExtractionTimeout`).
+  LIBWYVERN_SYMEXPORT
+  std::vector<BatchResult> extract_dependencies_batch(const std::vector<cmake::Configuration>& configs, Options options = {});
+
+  // Same as `extract_dependencies()`, with the targets extracted in shards of `Options::shard_size` configured
+  // independently, and a result for those which could be extracted: the targets of a failing shard are split
+  // in halves queued again, until the failing targets are alone. The shards and halves are extracted by one pool
+  // of at most `Options::max_jobs` threads (the hardware concurrency if 0). Nothing is split when CMake fails
+  // on a `find_package()` (the package is missing, or its files raise an error) or when every shard fails:
+  // all the targets fail with the same error.
+  // Only throws if the call must stop (`ExtractionCancelled`, `ExtractionTimeout`).
+  LIBWYVERN_SYMEXPORT
+  PartialDependenciesInfo extract_dependencies_sharded(const cmake::Configuration& config, Options options = {});
+
+  // Removes all the cached extraction results from the provided cache directory (see `Options::cache_directory`).
+  LIBWYVERN_SYMEXPORT
+  void clear_cache(const butl::dir_path& cache_directory);
+
   using path = butl::path; // File path
   using dir_path = butl::dir_path; // Directory path
 
@@ -101,7 +280,25 @@ namespace wyvern
     const dir_path& path() const { return this->path_; }
   };
 
+  // Process-wide logging settings, for what is logged outside of extractions (by `scoped_temp_dir`,
+  // `cmake::invoke_cmake()`...): extractions follow their options instead.
+  // Returns the previous setting.
   LIBWYVERN_SYMEXPORT
   bool enable_logging(bool is_enabled);
 
+  // Sets the least important messages logged when logging is enabled, returns the previous level.
+  LIBWYVERN_SYMEXPORT
+  LogLevel set_log_level(LogLevel level);
+
+  // Replaces where logged messages go (unless a call has its own, see `Options::log_sink`), an empty sink
+  // restores the default: the standard output, prefixed with "wyvern: ". Messages logged before are
+  // delivered to the previous sink.
+  // This lets, for example, a build system route the messages to its own diagnostics.
+  LIBWYVERN_SYMEXPORT
+  void set_log_sink(LogSink sink);
+
+  // Waits until all the messages logged so far are delivered to the sink.
+  LIBWYVERN_SYMEXPORT
+  void flush_log();
+
 }
@@ -1,11 +1,29 @@
 #include <cassert>
 #include <iostream>
+#include <sstream>
 #include <algorithm>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <cstdlib>
 
 #include <nocontracts/assert.hpp>
 
+#include <libbutl/filesystem.mxx>
+
 #include <libwyvern/version.hpp>
 #include <libwyvern/wyvern.hpp>
+#include <libwyvern/diff.hpp>
+#include <libwyvern/session.hpp>
+#include <libwyvern/utility.hpp>
+#include <libwyvern/file-api.hpp>
+#include <libwyvern/process-output.hpp>
 
 using namespace wyvern;
 
@@ -69,6 +87,615 @@ namespace {
 
 }
 
+namespace {
+
+  auto to_string(const DependenciesInfo& dependencies) -> std::string
+  {
+    std::ostringstream text;
+    text << dependencies;
+    return text.str();
+  }
+
+  // What the dependent project uses that the control project doesn't: the values of the left side which are not
+  // on the right, in their order, each value of the right removing one occurrence; what a language only used
+  // by the dependent project uses is kept, the languages only used by the control project are not reported.
+  void check_differences()
+  {
+    using strings = std::vector<std::string>;
+    NC_ASSERT_TRUE( detail::difference(strings{ "-b", "-a", "-c", "-a", "-d", "-a" }, strings{ "-a", "-d", "-a" }) == (strings{ "-b", "-c", "-a" }) );
+    NC_ASSERT_TRUE( detail::difference(strings{ "-a", "-b" }, strings{ "-a", "-a", "-c" }) == (strings{ "-b" }) );
+    NC_ASSERT_TRUE( detail::difference(strings{ "-a", "-a" }, strings{}) == (strings{ "-a", "-a" }) );
+    NC_ASSERT_TRUE( detail::difference(strings{}, strings{ "-a" }).empty() );
+
+    detail::ExtractionSession session;
+    const auto interned_difference = detail::difference(session.symbols.intern(strings{ "-b", "-a", "-c", "-a" }), session.symbols.intern(strings{ "-a" }));
+    NC_ASSERT_TRUE( session.symbols.strings_of(interned_difference) == (strings{ "-b", "-c", "-a" }) );
+
+    const auto control_target_name = std::string{ detail::target_prefix } + detail::control_target;
+    Target control_target;
+    control_target.name = control_target_name;
+    control_target.language_compilation["CXX"] = { { "/usr/include" }, { "-O2", "-Wall", "-O2" }, { "NDEBUG" }, {} };
+    control_target.language_compilation["Fortran"] = { {}, { "-ffree-form" }, {}, {} };
+    control_target.link_libraries = { "-lm" };
+    DependenciesInfo control;
+    control.configurations["Release"].targets[control_target_name] = control_target;
+
+    Target dependent_target;
+    dependent_target.name = std::string{ detail::target_prefix } + "dependency";
+    dependent_target.language_compilation["CXX"] = { { "/opt/dependency/include", "/usr/include" }, { "-O2", "-pthread", "-Wall", "-O2", "-O2" },
+                                                     { "NDEBUG", "DEPENDENCY_SHARED", "NDEBUG" }, {} };
+    dependent_target.language_compilation["C"] = { { "/usr/include" }, { "-O2" }, { "NDEBUG" }, {} };
+    dependent_target.link_libraries = { "-lm", "/opt/dependency/lib/libdependency.so", "-lm" };
+    cmake::CodeModel dependent;
+    auto& dependent_config = dependent.configs.emplace("Release", detail::InternedConfiguration{ session.memory() }).first->second;
+    dependent_config.targets.emplace(std::pmr::string{ dependent_target.name, session.memory() }, detail::intern(dependent_target, session.symbols));
+
+    const auto differences = detail::compare_dependencies(control, dependent, session);
+    const auto& dependency = differences.configurations.at("Release").targets.at("dependency");
+    NC_ASSERT_TRUE( dependency.language_compilation.size() == 2 );
+    const auto& cxx = dependency.language_compilation.at("CXX");
+    NC_ASSERT_TRUE( cxx.include_directories == (strings{ "/opt/dependency/include" }) );
+    NC_ASSERT_TRUE( cxx.compilation_flags == (strings{ "-pthread", "-O2" }) );
+    NC_ASSERT_TRUE( cxx.defines == (strings{ "DEPENDENCY_SHARED", "NDEBUG" }) );
+    const auto& c = dependency.language_compilation.at("C");
+    NC_ASSERT_TRUE( c.include_directories == (strings{ "/usr/include" }) );
+    NC_ASSERT_TRUE( c.compilation_flags == (strings{ "-O2" }) );
+    NC_ASSERT_TRUE( c.defines == (strings{ "NDEBUG" }) );
+    NC_ASSERT_TRUE( dependency.link_libraries == (strings{ "/opt/dependency/lib/libdependency.so", "-lm" }) );
+  }
+
+  // The tail of CMake's output keeps the latest bytes, whatever the size of what is appended at once.
+  void check_ring_buffer()
+  {
+    detail::RingBuffer buffer{ 8 };
+    buffer.append("abc");
+    NC_ASSERT_TRUE( buffer.content() == "abc" );
+    buffer.append("defgh"); // Exactly full.
+    NC_ASSERT_TRUE( buffer.content() == "abcdefgh" );
+    buffer.append("ij"); // Wraps around.
+    NC_ASSERT_TRUE( buffer.content() == "cdefghij" );
+    buffer.append("klmnopq"); // Across the end of the storage.
+    NC_ASSERT_TRUE( buffer.content() == "jklmnopq" );
+    buffer.append("0123456789"); // Larger than the buffer: truncated.
+    NC_ASSERT_TRUE( buffer.content() == "23456789" );
+    buffer.append("");
+    NC_ASSERT_TRUE( buffer.content() == "23456789" );
+    NC_ASSERT_TRUE( buffer.size() == 27 );
+
+    detail::RingBuffer empty_buffer{ 0 };
+    empty_buffer.append("abc");
+    NC_ASSERT_TRUE( empty_buffer.content().empty() );
+    NC_ASSERT_TRUE( empty_buffer.size() == 3 );
+  }
+
+  // Many extractions at once from different threads, each with its own settings,
+  // as the parallel jobs of a build system would do.
+  void check_concurrent_extractions(const cmake::Configuration& config, const Options& options, const DependenciesInfo& expected)
+  {
+    const std::size_t extraction_count = 8;
+    std::vector<DependenciesInfo> results(extraction_count);
+    std::vector<std::size_t> logged_messages(extraction_count, 0);
+    std::vector<std::exception_ptr> failures(extraction_count);
+
+    std::vector<std::thread> threads;
+    for(std::size_t extraction_idx = 0; extraction_idx < extraction_count; ++extraction_idx)
+    {
+      threads.emplace_back([&, extraction_idx]{
+        auto extraction_options = options;
+        extraction_options.enable_logging = extraction_idx % 2 == 0; // Different settings in each call.
+        extraction_options.log_level = LogLevel::info;
+        extraction_options.log_sink = [&, extraction_idx](LogLevel, std::string_view){ ++logged_messages[extraction_idx]; };
+        extraction_options.trace_file = {};
+        try
+        {
+          results[extraction_idx] = extract_dependencies(config, extraction_options);
+        }
+        catch(...)
+        {
+          failures[extraction_idx] = std::current_exception();
+        }
+      });
+    }
+    for(auto& thread : threads)
+      thread.join();
+
+    for(std::size_t extraction_idx = 0; extraction_idx < extraction_count; ++extraction_idx)
+    {
+      if(failures[extraction_idx])
+        std::rethrow_exception(failures[extraction_idx]);
+      NC_ASSERT_TRUE( to_string(results[extraction_idx]) == to_string(expected) );
+      // Each call only logged through its own sink, if its logging was enabled.
+      NC_ASSERT_TRUE( (logged_messages[extraction_idx] > 0) == (extraction_idx % 2 == 0) );
+    }
+  }
+
+  void set_environment_variable(const char* name, const char* value)
+  {
+#ifdef _WIN32
+    _putenv_s(name, value ? value : "");
+#else
+    if(value)
+      setenv(name, value, 1);
+    else
+      unsetenv(name);
+#endif
+  }
+
+  // Changes an environment variable until destroyed (the extractions read the compiler's environment, see `check_control_reuse`).
+  class scoped_environment_variable
+  {
+  public:
+    scoped_environment_variable(const char* name, const char* value)
+      : name{ name }
+    {
+      if(const auto previous_value = std::getenv(name))
+        this->previous_value = previous_value;
+      set_environment_variable(name, value);
+    }
+
+    ~scoped_environment_variable()
+    {
+      set_environment_variable(name, previous_value ? previous_value->c_str() : nullptr);
+    }
+
+    scoped_environment_variable(const scoped_environment_variable&) = delete;
+    scoped_environment_variable& operator=(const scoped_environment_variable&) = delete;
+
+  private:
+    const char* name;
+    std::optional<std::string> previous_value;
+  };
+
+  // Results reused from the cache directory without running CMake, until a file CMake read to find
+  // the packages changes, the compiler's environment changes, the cache is refreshed, or cleared.
+  void check_result_cache(const cmake::Configuration& config, const Options& options, const DependenciesInfo& expected,
+                          const path& package_config_file)
+  {
+    const scoped_temp_dir cache_dir{ keep_generated_directories };
+    auto cached_options = options;
+    cached_options.cache_directory = cache_dir.path();
+    cached_options.trace_file = {};
+    std::atomic<int> output_lines_count{ 0 };
+    cached_options.cmake_output_handler = [&](std::string_view){ ++output_lines_count; };
+
+    NC_ASSERT_TRUE( to_string(extract_dependencies(config, cached_options)) == to_string(expected) );
+    NC_ASSERT_TRUE( output_lines_count > 0 );
+
+    output_lines_count = 0;
+    NC_ASSERT_TRUE( to_string(extract_dependencies(config, cached_options)) == to_string(expected) );
+    NC_ASSERT_TRUE( output_lines_count == 0 );
+
+    // Touched: the entry is outdated, and replaced.
+    const auto config_file = std::filesystem::path{ package_config_file.string() };
+    std::filesystem::last_write_time(config_file, std::filesystem::last_write_time(config_file) + std::chrono::seconds{ 1 });
+    NC_ASSERT_TRUE( to_string(extract_dependencies(config, cached_options)) == to_string(expected) );
+    NC_ASSERT_TRUE( output_lines_count > 0 );
+
+    output_lines_count = 0;
+    NC_ASSERT_TRUE( to_string(extract_dependencies(config, cached_options)) == to_string(expected) );
+    NC_ASSERT_TRUE( output_lines_count == 0 );
+
+    // Other compiler flags: the entry does not apply, another one is stored.
+    {
+      const scoped_environment_variable cxx_flags{ "CXXFLAGS", "-DWYVERN_RESULT_CACHE_CHECK" };
+      NC_ASSERT_TRUE( to_string(extract_dependencies(config, cached_options)) == to_string(expected) );
+      NC_ASSERT_TRUE( output_lines_count > 0 );
+
+      output_lines_count = 0;
+      NC_ASSERT_TRUE( to_string(extract_dependencies(config, cached_options)) == to_string(expected) );
+      NC_ASSERT_TRUE( output_lines_count == 0 );
+    }
+    NC_ASSERT_TRUE( to_string(extract_dependencies(config, cached_options)) == to_string(expected) );
+    NC_ASSERT_TRUE( output_lines_count == 0 );
+
+    auto refreshed_options = cached_options;
+    refreshed_options.refresh_cache = true;
+    NC_ASSERT_TRUE( to_string(extract_dependencies(config, refreshed_options)) == to_string(expected) );
+    NC_ASSERT_TRUE( output_lines_count > 0 );
+
+    clear_cache(cache_dir.path());
+    NC_ASSERT_TRUE( std::filesystem::is_empty(std::filesystem::path{ cache_dir.path().string() }) );
+  }
+
+  // The control information extracted in the process is reused by the extractions with the same toolchain,
+  // and extracted again when the compiler's environment changes.
+  void check_control_reuse(const cmake::Configuration& config, const Options& options, const DependenciesInfo& expected)
+  {
+    auto reuse_options = options;
+    reuse_options.trace_file = {};
+    reuse_options.enable_logging = true;
+    reuse_options.log_level = LogLevel::info;
+    std::atomic<int> reuses_count{ 0 };
+    reuse_options.log_sink = [&](LogLevel, std::string_view message){
+      if(message.find("reusing control information") != std::string_view::npos)
+        ++reuses_count;
+    };
+
+    NC_ASSERT_TRUE( to_string(extract_dependencies(config, reuse_options)) == to_string(expected) );
+    NC_ASSERT_TRUE( reuses_count == 1 ); // Extracted by the first extraction of the test.
+
+    {
+      const scoped_environment_variable cxx_flags{ "CXXFLAGS", "-DWYVERN_CONTROL_REUSE_CHECK" };
+      NC_ASSERT_TRUE( to_string(extract_dependencies(config, reuse_options)) == to_string(expected) ); // In both projects, so not a dependency's.
+      NC_ASSERT_TRUE( reuses_count == 1 );
+    }
+
+    NC_ASSERT_TRUE( to_string(extract_dependencies(config, reuse_options)) == to_string(expected) );
+    NC_ASSERT_TRUE( reuses_count == 2 );
+  }
+
+  // Compatible configurations are extracted together, then each gets back only its own targets;
+  // a failing group does not fail the others.
+  void check_batch_extraction(const cmake::Configuration& config, const Options& options)
+  {
+    auto batch_options = options;
+    batch_options.trace_file = {};
+    batch_options.enable_logging = true;
+    batch_options.log_level = LogLevel::info;
+    std::atomic<bool> is_grouped{ false };
+    batch_options.log_sink = [&](LogLevel, std::string_view message){
+      if(message.find("merged in 3 groups") != std::string_view::npos)
+        is_grouped = true;
+    };
+
+    auto project_config = config; // Compatible with the user project's: merged.
+    project_config.packages = { { test_project_package_name } };
+    project_config.targets = test_project_targets;
+    auto user_config = config;
+    user_config.targets = test_project_user_targets;
+    auto other_options_config = user_config; // Different options: extracted separately.
+    other_options_config.options.push_back({ "WYVERN_BATCH_GROUP", "other" });
+    auto failing_config = user_config;
+    failing_config.packages.push_back({ "WyvernMissingPackage", "", {} });
+    failing_config.options.push_back({ "WYVERN_BATCH_GROUP", "failing" });
+
+    const std::vector<cmake::Configuration> configs{ project_config, user_config, other_options_config, failing_config };
+    const auto results = extract_dependencies_batch(configs, batch_options);
+    NC_ASSERT_TRUE( is_grouped );
+    NC_ASSERT_TRUE( results.size() == configs.size() );
+
+    auto single_options = options;
+    single_options.trace_file = {};
+    for(std::size_t config_idx = 0; config_idx + 1 < configs.size(); ++config_idx)
+    {
+      NC_ASSERT_TRUE( results[config_idx].error.empty() );
+      NC_ASSERT_TRUE( to_string(results[config_idx].dependencies) == to_string(extract_dependencies(configs[config_idx], single_options)) );
+    }
+    NC_ASSERT_TRUE( results.back().dependencies.empty() );
+    NC_ASSERT_TRUE( results.back().error.find("WyvernMissingPackage") != std::string::npos );
+  }
+
+  // Extractions stopped while CMake runs: cancelled from another thread, or running out of time.
+  void check_interruptions(const cmake::Configuration& config, const Options& options)
+  {
+    auto cancelled_options = options;
+    CancellationToken cancellation;
+    cancelled_options.cancellation = cancellation;
+    cancelled_options.cmake_output_handler = [cancellation](std::string_view) mutable {
+      cancellation.cancel(); // While CMake runs, or just after: it is checked again before the replies are read.
+    };
+    cancelled_options.trace_file = {};
+    auto cancelled_extraction = extract_dependencies_async(config, cancelled_options);
+    bool is_cancelled = false;
+    try
+    {
+      cancelled_extraction.get();
+    }
+    catch(const ExtractionCancelled&)
+    {
+      is_cancelled = true;
+    }
+    catch(const std::exception& error)
+    {
+      std::cerr << "unexpected failure of the cancelled extraction: " << error.what() << std::endl;
+    }
+    NC_ASSERT_TRUE( is_cancelled );
+
+    auto timed_options = options;
+    timed_options.timeouts.configure = std::chrono::milliseconds{ 1 };
+    timed_options.trace_file = {};
+    bool is_timed_out = false;
+    try
+    {
+      extract_dependencies(config, timed_options);
+    }
+    catch(const ExtractionTimeout&)
+    {
+      is_timed_out = true;
+    }
+    catch(const std::exception& error)
+    {
+      std::cerr << "unexpected failure of the timed out extraction: " << error.what() << std::endl;
+    }
+    NC_ASSERT_TRUE( is_timed_out );
+  }
+
+  // Extractions sharing persistent projects: concurrently (one at a time in each project), then reconfiguring them.
+  void check_work_directory(const cmake::Configuration& config, const Options& options, const DependenciesInfo& expected)
+  {
+    const scoped_temp_dir work_dir{ keep_generated_directories };
+    auto persistent_options = options;
+    persistent_options.work_directory = work_dir.path();
+    persistent_options.refresh_cache = true; // The control project is extracted each time too.
+    persistent_options.trace_file = {};
+
+    const std::size_t extraction_count = 3;
+    std::vector<DependenciesInfo> results(extraction_count);
+    std::vector<std::exception_ptr> failures(extraction_count);
+    std::vector<std::thread> threads;
+    for(std::size_t extraction_idx = 0; extraction_idx < extraction_count; ++extraction_idx)
+    {
+      threads.emplace_back([&, extraction_idx]{
+        try
+        {
+          results[extraction_idx] = extract_dependencies(config, persistent_options);
+        }
+        catch(...)
+        {
+          failures[extraction_idx] = std::current_exception();
+        }
+      });
+    }
+    for(auto& thread : threads)
+      thread.join();
+
+    for(std::size_t extraction_idx = 0; extraction_idx < extraction_count; ++extraction_idx)
+    {
+      if(failures[extraction_idx])
+        std::rethrow_exception(failures[extraction_idx]);
+      NC_ASSERT_TRUE( to_string(results[extraction_idx]) == to_string(expected) );
+    }
+
+    NC_ASSERT_TRUE( to_string(extract_dependencies(config, persistent_options)) == to_string(expected) );
+
+    // Another compiler environment gets projects of its own: the build directories configured with the
+    // previous one are not reconfigured (their CMakeCache.txt would keep the previous compiler).
+    auto logged_options = persistent_options;
+    logged_options.enable_logging = true;
+    logged_options.log_level = LogLevel::info;
+    std::atomic<int> reconfigurations_count{ 0 };
+    logged_options.log_sink = [&](LogLevel, std::string_view message){
+      if(message.find("reconfiguring") != std::string_view::npos)
+        ++reconfigurations_count;
+    };
+    {
+      const scoped_environment_variable cxx_flags{ "CXXFLAGS", "-DWYVERN_WORK_DIRECTORY_CHECK" };
+      NC_ASSERT_TRUE( to_string(extract_dependencies(config, logged_options)) == to_string(expected) );
+      NC_ASSERT_TRUE( reconfigurations_count == 0 );
+    }
+    NC_ASSERT_TRUE( to_string(extract_dependencies(config, logged_options)) == to_string(expected) );
+    NC_ASSERT_TRUE( reconfigurations_count > 0 );
+  }
+
+  // An alternative to the comparison with the control project (see `Backend`, `Options::read_export_files`), set by
+  // `use_alternative`, gives what the comparison gives, without CMake printing what `is_unexpected_output` matches.
+  // Once `make_unsupported` changed the configuration so that it can't, it falls back to the comparison,
+  // logging `fallback_message` once.
+  void check_alternative_extraction(cmake::Configuration config, const Options& options, const DependenciesInfo& expected,
+                                    const std::function<void(Options&)>& use_alternative,
+                                    const std::function<void(cmake::Configuration&)>& make_unsupported,
+                                    const std::function<bool(std::string_view line)>& is_unexpected_output,
+                                    std::string_view fallback_message)
+  {
+    auto diff_options = options;
+    diff_options.trace_file = {};
+    auto alternative_options = diff_options;
+    use_alternative(alternative_options);
+    std::atomic<int> unexpected_lines_count{ 0 };
+    alternative_options.cmake_output_handler = [&](std::string_view line){
+      if(is_unexpected_output(line))
+        ++unexpected_lines_count;
+    };
+    NC_ASSERT_TRUE( to_string(extract_dependencies(config, alternative_options)) == to_string(expected) );
+    NC_ASSERT_TRUE( unexpected_lines_count == 0 );
+
+    make_unsupported(config);
+    alternative_options.validation = Validation::none; // What makes it unsupported may not build.
+    diff_options.validation = Validation::none;
+    std::atomic<int> fallbacks_count{ 0 }; // The sink is called from the logging thread.
+    alternative_options.enable_logging = true;
+    alternative_options.log_level = LogLevel::info;
+    alternative_options.log_sink = [&](LogLevel, std::string_view message){
+      if(message.find(fallback_message) != std::string_view::npos)
+        ++fallbacks_count;
+    };
+    NC_ASSERT_TRUE( to_string(extract_dependencies(config, alternative_options)) == to_string(extract_dependencies(config, diff_options)) );
+    NC_ASSERT_TRUE( fallbacks_count == 1 );
+  }
+
+  // Reading the export files gives what CMake extracts, without running it, and falls back to CMake when it can't.
+  void check_export_files_reading(cmake::Configuration config, const Options& options)
+  {
+    config.args.clear(); // Not supported by the reading.
+    auto cmake_options = options;
+    cmake_options.validation = Validation::none; // Nor validating the information.
+    cmake_options.trace_file = {};
+    const auto expected = extract_dependencies(config, cmake_options); // Also detects the toolchain the reading uses.
+
+    check_alternative_extraction(config, cmake_options, expected,
+      [](Options& reading_options){ reading_options.read_export_files = true; },
+      [](cmake::Configuration& unsupported_config){
+        unsupported_config.options.push_back({ "WYVERN_UNKNOWN_VARIABLE", "ON" }); // Only CMake knows what it changes.
+      },
+      [](std::string_view){ return true; }, // CMake is not run.
+      "extracting with CMake");
+  }
+
+  // Not a target of the packages: neither the generated usage requirements nor the trace tell how it is linked.
+  void add_library_target(cmake::Configuration& config)
+  {
+    config.targets.push_back("m");
+  }
+
+  // The usage requirements CMake generates in the project with the dependencies give what the comparison with
+  // the control project gives, which is used when they can't.
+  void check_generated_properties(const cmake::Configuration& config, const Options& options, const DependenciesInfo& expected)
+  {
+    check_alternative_extraction(config, options, expected,
+      [](Options& generated_options){ generated_options.backend = Backend::generated_properties; },
+      add_library_target,
+      [](std::string_view){ return false; },
+      "extracting with the control project");
+  }
+
+  // The imported targets reconstructed from CMake's trace give what the comparison with the control project gives,
+  // which is used when they can't. The trace is read without being passed to the output handler.
+  void check_traced_imported_targets(const cmake::Configuration& config, const Options& options, const DependenciesInfo& expected)
+  {
+    check_alternative_extraction(config, options, expected,
+      [](Options& traced_options){ traced_options.backend = Backend::trace; },
+      add_library_target,
+      [](std::string_view line){ return line.find("{\"args\":") == 0; },
+      "extracting with the control project");
+  }
+
+  // The requested configurations come out of one extraction, each as an extraction with that build type gives it.
+  void check_several_configurations(cmake::Configuration config, const Options& options)
+  {
+    auto configurations_options = options;
+    configurations_options.trace_file = {};
+    config.configurations = { "Debug", "Release" };
+    const auto dependencies = extract_dependencies(config, configurations_options);
+    NC_ASSERT_TRUE( dependencies.configurations.size() == config.configurations.size() );
+
+    for(const auto& name : config.configurations)
+    {
+      auto single_config = config;
+      single_config.configurations.clear();
+      single_config.options.push_back({ "CMAKE_BUILD_TYPE", name });
+      const auto expected = extract_dependencies(single_config, configurations_options);
+      NC_ASSERT_TRUE( expected.configurations.count(name) == 1 );
+
+      DependenciesInfo configuration_dependencies;
+      const auto found = dependencies.configurations.find(name);
+      NC_ASSERT_TRUE( found != dependencies.configurations.end() );
+      configuration_dependencies.configurations.insert(*found);
+      NC_ASSERT_TRUE( to_string(configuration_dependencies) == to_string(expected) );
+    }
+  }
+
+  // A target which can't be extracted only fails itself: the shards it is in are split until it is alone.
+  // Adds a package found by its configuration file, made of `code`, written in `directory`.
+  void add_package(cmake::Configuration& config, const dir_path& directory, const std::string& name, const std::string& code)
+  {
+    std::ofstream{ (directory / path(name + "Config.cmake")).string() } << code;
+    config.packages.push_back({ name, "", {} });
+    config.options.push_back({ name + "_DIR", directory.string() });
+  }
+
+  void check_sharded_extraction(cmake::Configuration config, const Options& options, const DependenciesInfo& expected)
+  {
+    const auto missing_target = "wyvern_missing::target";
+    auto targets = config.targets;
+    const auto packages = config.packages;
+    const auto cmake_options = config.options;
+    config.targets.insert(config.targets.begin() + 1, missing_target);
+
+    // A warning raised by a package does not fail it: the failing target is still isolated.
+    const scoped_temp_dir packages_dir{ keep_generated_directories };
+    add_package(config, packages_dir.path(), "WyvernWarningPackage", "message(AUTHOR_WARNING \"wyvern sharding check\")\n");
+
+    auto sharded_options = options;
+    sharded_options.trace_file = {};
+    sharded_options.shard_size = 2;
+    const auto result = extract_dependencies_sharded(config, sharded_options);
+    NC_ASSERT_TRUE( to_string(result.dependencies) == to_string(expected) );
+    NC_ASSERT_TRUE( result.targets.size() == config.targets.size() );
+    for(const auto& target : targets)
+      NC_ASSERT_TRUE( result.targets.at(target).is_extracted && result.targets.at(target).error.empty() );
+    NC_ASSERT_TRUE( !result.targets.at(missing_target).is_extracted );
+    NC_ASSERT_TRUE( result.targets.at(missing_target).error.find(missing_target) != std::string::npos );
+
+    // A missing package, or one whose configuration file fails, fails every shard the same way:
+    // nothing is split, all the targets fail.
+    sharded_options.enable_logging = true;
+    sharded_options.log_level = LogLevel::info;
+    std::atomic<int> splits_count{ 0 };
+    sharded_options.log_sink = [&](LogLevel, std::string_view message){
+      if(message.find("splitting them") != std::string_view::npos)
+        ++splits_count;
+    };
+    const auto check_package_failure = [&](const cmake::Configuration& failing_config, const std::string& package_name){
+      const auto failed_result = extract_dependencies_sharded(failing_config, sharded_options);
+      NC_ASSERT_TRUE( failed_result.dependencies.configurations.empty() );
+      NC_ASSERT_TRUE( failed_result.targets.size() == targets.size() );
+      for(const auto& target : targets)
+      {
+        NC_ASSERT_TRUE( !failed_result.targets.at(target).is_extracted );
+        NC_ASSERT_TRUE( failed_result.targets.at(target).error.find(package_name) != std::string::npos );
+      }
+      NC_ASSERT_TRUE( splits_count == 0 );
+    };
+
+    config.targets = targets;
+    config.packages = packages;
+    config.options = cmake_options;
+    auto missing_package_config = config;
+    missing_package_config.packages.push_back({ "WyvernMissingPackage", "", {} });
+    check_package_failure(missing_package_config, "WyvernMissingPackage");
+
+    auto failing_package_config = config;
+    add_package(failing_package_config, packages_dir.path(), "WyvernFailingPackage",
+                "message(FATAL_ERROR \"WyvernFailingPackage can't be used\")\n");
+    check_package_failure(failing_package_config, "WyvernFailingPackage");
+  }
+
+  void check_cmake_errors(cmake::Configuration config, const Options& options)
+  {
+    config.packages.push_back({ "WyvernMissingPackage", "", {} });
+    auto failing_options = options;
+    std::atomic<int> output_lines_count{ 0 };
+    failing_options.cmake_output_handler = [&](std::string_view){ ++output_lines_count; };
+    failing_options.trace_file = {};
+    bool is_failed = false;
+    try
+    {
+      extract_dependencies(config, failing_options);
+    }
+    catch(const CMakeError& error)
+    {
+      is_failed = true;
+      // CMake's own explanation is part of the error.
+      NC_ASSERT_TRUE( error.output.find("WyvernMissingPackage") != std::string::npos );
+      NC_ASSERT_TRUE( std::string_view{ error.what() }.find("WyvernMissingPackage") != std::string_view::npos );
+    }
+    NC_ASSERT_TRUE( is_failed );
+    NC_ASSERT_TRUE( output_lines_count > 0 );
+
+    // Only the latest bytes of the output are kept, the end of the last lines CMake printed.
+    const std::size_t tail_size = 64;
+    failing_options.cmake_output_tail_size = tail_size;
+    std::mutex output_lines_mutex;
+    std::vector<std::string> output_lines;
+    failing_options.cmake_output_handler = [&](std::string_view line){
+      const std::lock_guard<std::mutex> lock{ output_lines_mutex };
+      output_lines.emplace_back(line);
+    };
+    is_failed = false;
+    try
+    {
+      extract_dependencies(config, failing_options);
+    }
+    catch(const CMakeError& error)
+    {
+      is_failed = true;
+      NC_ASSERT_TRUE( !error.output.empty() && error.output.size() <= tail_size );
+      NC_ASSERT_TRUE( error.output.back() == '\n' );
+      auto last_line = std::string_view{ error.output }.substr(0, error.output.size() - 1);
+      const auto last_line_begin = last_line.rfind('\n');
+      if(last_line_begin != std::string_view::npos)
+        last_line.remove_prefix(last_line_begin + 1);
+      // Possibly cut at the beginning of the tail: the end of a line CMake printed.
+      const auto is_printed = std::any_of(output_lines.begin(), output_lines.end(), [&](const std::string& line){
+        return line.size() >= last_line.size() && line.compare(line.size() - last_line.size(), last_line.size(), last_line) == 0;
+      });
+      NC_ASSERT_TRUE( is_printed );
+    }
+    NC_ASSERT_TRUE( is_failed );
+  }
+
+}
+
 int main ()
 {
 
@@ -76,6 +703,8 @@ int main ()
   {
     wyvern::enable_logging(enable_loggging);
 
+    check_differences();
+    check_ring_buffer();
 
     auto test_cmake_project_dir = build_install(test_project_sources_dir, test_project_build_dir_name, test_install_dir_name);
     const auto test_install_dir = (test_cmake_project_dir.path() / test_install_dir_name).normalize(true, true);
@@ -98,11 +727,34 @@ void check() {{
     options.enable_logging = enable_loggging;
     options.code_format_to_inject_in_client = check_code;
     options.keep_generated_projects = keep_generated_directories;
+    options.trace_file = test_cmake_project_dir.path() / path("wyvern-trace.json");
+
+    std::size_t logged_messages = 0;
+    set_log_sink([&](LogLevel, std::string_view message){
+      ++logged_messages;
+      std::cout << "wyvern: " << message << '\n';
+    });
 
     const auto deps_info = extract_dependencies(config, options);
     NC_ASSERT_TRUE( !deps_info.empty() );
+    NC_ASSERT_TRUE( butl::file_exists(options.trace_file) );
+    NC_ASSERT_TRUE( !enable_loggging || logged_messages > 0 ); // Delivered when the extraction returns.
+    set_log_sink({});
+
+    check_concurrent_extractions(config, options, deps_info);
+    check_control_reuse(config, options, deps_info);
+    check_result_cache(config, options, deps_info,
+      test_install_dir / dir_path("lib/cmake/test_cmake_project") / path("test_cmake_project-config.cmake"));
+    check_batch_extraction(config, options);
+    check_interruptions(config, options);
+    check_cmake_errors(config, options);
+    check_work_directory(config, options, deps_info);
+    check_export_files_reading(config, options);
+    check_generated_properties(config, options, deps_info);
+    check_traced_imported_targets(config, options, deps_info);
+    check_several_configurations(config, options);
+    check_sharded_extraction(config, options, deps_info);
 
-    // TODO: add checks here
     std::cout << "############# DEDUCED DEPENDENCIES ##############" << std::endl;
     std::cout << deps_info << std::endl;
 
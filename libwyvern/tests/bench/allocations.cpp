@@ -0,0 +1,105 @@
+#include <new>
+#include <atomic>
+#include <cstdlib>
+#include <algorithm>
+
+#include "bench.hpp"
+
+#ifdef _WIN32
+#  ifndef WIN32_LEAN_AND_MEAN
+#    define WIN32_LEAN_AND_MEAN
+#  endif
+#  include <windows.h>
+#  include <psapi.h>
+#else
+#  include <sys/resource.h>
+#endif
+
+// Replaces the global allocation functions to count the allocations of the whole process,
+// the library included. Each block is prefixed with its size to track the memory in use.
+// Also reports the peak resident memory, which includes what is not allocated by operator new.
+
+namespace wyvern::bench {
+namespace {
+
+  std::atomic<std::size_t> allocation_count{ 0 };
+  std::atomic<std::size_t> allocated_bytes{ 0 };
+  std::atomic<std::size_t> used_bytes{ 0 };
+  std::atomic<std::size_t> peak_used_bytes{ 0 };
+
+  constexpr std::size_t header_size = alignof(std::max_align_t);
+
+  auto allocate(std::size_t size) -> void*
+  {
+    auto block = static_cast<char*>(std::malloc(size + header_size));
+    if(block == nullptr)
+      throw std::bad_alloc{};
+    *reinterpret_cast<std::size_t*>(block) = size;
+
+    ++allocation_count;
+    allocated_bytes += size;
+    const auto used = used_bytes += size;
+    auto peak = peak_used_bytes.load();
+    while(used > peak && !peak_used_bytes.compare_exchange_weak(peak, used)) {}
+
+    return block + header_size;
+  }
+
+  auto deallocate(void* pointer) -> void
+  {
+    if(pointer == nullptr)
+      return;
+    auto block = static_cast<char*>(pointer) - header_size;
+    used_bytes -= *reinterpret_cast<std::size_t*>(block);
+    std::free(block);
+  }
+
+}
+
+  auto allocations() -> Allocations
+  {
+    return { allocation_count, allocated_bytes, used_bytes, peak_used_bytes };
+  }
+
+  auto reset_peak_used_bytes() -> void
+  {
+    peak_used_bytes = used_bytes.load();
+  }
+
+  auto peak_rss_bytes() -> std::size_t
+  {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+      return 0;
+    return counters.PeakWorkingSetSize;
+#else
+    rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+      return 0;
+#  ifdef __APPLE__
+    return static_cast<std::size_t>(usage.ru_maxrss); // In bytes.
+#  else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024; // In kilobytes.
+#  endif
+#endif
+  }
+
+}
+
+void* operator new(std::size_t size) { return wyvern::bench::allocate(size); }
+void* operator new[](std::size_t size) { return wyvern::bench::allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+  try { return wyvern::bench::allocate(size); } catch(...) { return nullptr; }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+  try { return wyvern::bench::allocate(size); } catch(...) { return nullptr; }
+}
+void operator delete(void* pointer) noexcept { wyvern::bench::deallocate(pointer); }
+void operator delete[](void* pointer) noexcept { wyvern::bench::deallocate(pointer); }
+void operator delete(void* pointer, std::size_t) noexcept { wyvern::bench::deallocate(pointer); }
+void operator delete[](void* pointer, std::size_t) noexcept { wyvern::bench::deallocate(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { wyvern::bench::deallocate(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { wyvern::bench::deallocate(pointer); }
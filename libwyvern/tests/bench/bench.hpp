@@ -0,0 +1,119 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <iostream>
+
+#include <fmt/format.h>
+
+namespace wyvern::bench {
+
+  using clock = std::chrono::steady_clock;
+  using milliseconds = std::chrono::duration<double, std::milli>;
+
+  struct Measure
+  {
+    std::string name;
+    std::vector<milliseconds> samples;
+
+    milliseconds min() const { return *std::min_element(samples.begin(), samples.end()); }
+    milliseconds max() const { return *std::max_element(samples.begin(), samples.end()); }
+    milliseconds mean() const
+    {
+      milliseconds total{};
+      for(const auto& sample : samples)
+        total += sample;
+      return total / samples.size();
+    }
+  };
+
+  // Runs `work` `iterations` times and returns the duration of each run.
+  template<class Work>
+  auto measure(std::string name, int iterations, Work&& work) -> Measure
+  {
+    Measure result{ std::move(name) };
+    for(int i = 0; i < iterations; ++i)
+    {
+      const auto begin = clock::now();
+      work();
+      result.samples.push_back(clock::now() - begin);
+    }
+    return result;
+  }
+
+  inline auto report(const Measure& measure) -> void
+  {
+    std::cout << fmt::format("  {:<40} mean {:>10.3f} ms | min {:>10.3f} ms | max {:>10.3f} ms ({} runs)",
+      measure.name, measure.mean().count(), measure.min().count(), measure.max().count(), measure.samples.size())
+      << std::endl;
+  }
+
+  // Same, with the throughput of processing `bytes` in each run.
+  inline auto report(const Measure& measure, std::size_t bytes) -> void
+  {
+    const auto megabytes = bytes / (1024.0 * 1024.0);
+    std::cout << fmt::format("  {:<40} mean {:>10.3f} ms | min {:>10.3f} ms | {:>8.1f} MB/s ({} runs)",
+      measure.name, measure.mean().count(), measure.min().count(), megabytes / (measure.mean().count() / 1000.0), measure.samples.size())
+      << std::endl;
+  }
+
+  inline auto report_speedup(const Measure& baseline, const Measure& improved) -> void
+  {
+    std::cout << fmt::format("  => {} is {:.2f}x faster than {}", improved.name, baseline.mean() / improved.mean(), baseline.name)
+      << std::endl;
+  }
+
+  // Allocations made through the global operator new since the start of the program (see allocations.cpp).
+  struct Allocations
+  {
+    std::size_t count = 0;
+    std::size_t bytes = 0; // Total of the allocated sizes.
+    std::size_t used_bytes = 0; // Allocated and not yet deallocated.
+    std::size_t peak_used_bytes = 0;
+  };
+
+  auto allocations() -> Allocations;
+  auto reset_peak_used_bytes() -> void;
+
+  // Maximum resident memory of the process since it started, 0 if not available.
+  auto peak_rss_bytes() -> std::size_t;
+
+  // Runs `work` once and returns the allocations it made, its peak being relative to the memory used before.
+  template<class Work>
+  auto count_allocations(std::string name, Work&& work) -> std::pair<std::string, Allocations>
+  {
+    reset_peak_used_bytes();
+    const auto before = allocations();
+    work();
+    const auto after = allocations();
+    return { std::move(name), { after.count - before.count, after.bytes - before.bytes,
+                                after.used_bytes - before.used_bytes, after.peak_used_bytes - before.used_bytes } };
+  }
+
+  inline auto report(const std::pair<std::string, Allocations>& measure) -> void
+  {
+    const auto& [name, allocations] = measure;
+    std::cout << fmt::format("  {:<40} {:>10} allocations | {:>10.1f} MB allocated | {:>8.1f} MB peak",
+      name, allocations.count, allocations.bytes / (1024.0 * 1024.0), allocations.peak_used_bytes / (1024.0 * 1024.0))
+      << std::endl;
+  }
+
+  // Benchmarks, each one is a named entry point that can be selected from the command line.
+  struct Benchmark
+  {
+    const char* name;
+    const char* description;
+    std::function<void()> run;
+  };
+
+  auto extraction_benchmarks() -> std::vector<Benchmark>;
+  auto reply_benchmarks() -> std::vector<Benchmark>;
+  auto diff_benchmarks() -> std::vector<Benchmark>;
+  auto names_benchmarks() -> std::vector<Benchmark>;
+  auto pipeline_benchmarks() -> std::vector<Benchmark>;
+  auto logging_benchmarks() -> std::vector<Benchmark>;
+
+}
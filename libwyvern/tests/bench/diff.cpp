@@ -0,0 +1,71 @@
+#include <random>
+#include <iterator>
+#include <algorithm>
+
+#include <libwyvern/diff.hpp>
+
+#include "bench.hpp"
+
+// Benchmarks of the differences computed between the dependent and control projects' values.
+
+namespace wyvern::bench {
+namespace {
+
+  const int iterations = 20;
+
+  // How differences were computed before: both sides sorted, losing the order of the left values.
+  auto sorted_difference(std::vector<std::string> left, std::vector<std::string> right)
+  {
+    std::sort(left.begin(), left.end());
+    std::sort(right.begin(), right.end());
+    std::vector<std::string> diff;
+    std::set_difference(left.begin(), left.end(), right.begin(), right.end(), std::back_inserter(diff));
+    return diff;
+  }
+
+  // Flags looking like the ones of a dependent project: the control's flags, shuffled with
+  // the same number of flags coming from the dependencies.
+  auto generate_flags(std::size_t count)
+  {
+    std::vector<std::string> control;
+    for(std::size_t index = 0; index < count / 2; ++index)
+      control.push_back(fmt::format("-I/usr/local/include/control/component_{}/include", index));
+
+    auto dependent = control;
+    for(std::size_t index = 0; index < count / 2; ++index)
+      dependent.push_back(fmt::format("-I/opt/dependencies/package_{}/include", index));
+    std::shuffle(dependent.begin(), dependent.end(), std::mt19937{ 42 });
+
+    return std::make_pair(dependent, control);
+  }
+
+  auto flags_difference() -> void
+  {
+    const std::size_t count = 10000;
+    const auto [dependent, control] = generate_flags(count);
+    std::cout << fmt::format(" {} dependent flags, {} control flags", dependent.size(), control.size()) << std::endl;
+
+    const auto sorted = measure("sort + set_difference", iterations, [&]{
+      sorted_difference(dependent, control);
+    });
+    report(sorted);
+
+    const auto hashed = measure("hashed, order preserving", iterations, [&]{
+      detail::difference(dependent, control);
+    });
+    report(hashed);
+
+    report_speedup(sorted, hashed);
+  }
+
+}
+
+  auto diff_benchmarks() -> std::vector<Benchmark>
+  {
+    return {
+      { "flags-difference", "differences between 10k flags, sorted or hashed",
+        flags_difference },
+    };
+  }
+
+}
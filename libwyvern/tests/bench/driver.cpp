@@ -0,0 +1,48 @@
+#include <iostream>
+#include <algorithm>
+
+#include "bench.hpp"
+
+using namespace wyvern::bench;
+
+// usage: bench [<benchmark>...]
+// Runs all the benchmarks when none are specified.
+int main (int argc, char* argv[])
+{
+  std::vector<Benchmark> benchmarks = extraction_benchmarks();
+  for(auto& benchmark : reply_benchmarks())
+    benchmarks.push_back(std::move(benchmark));
+  for(auto& benchmark : diff_benchmarks())
+    benchmarks.push_back(std::move(benchmark));
+  for(auto& benchmark : names_benchmarks())
+    benchmarks.push_back(std::move(benchmark));
+  for(auto& benchmark : pipeline_benchmarks())
+    benchmarks.push_back(std::move(benchmark));
+  for(auto& benchmark : logging_benchmarks())
+    benchmarks.push_back(std::move(benchmark));
+
+  const std::vector<std::string> selected(argv + 1, argv + argc);
+  const auto is_selected = [&](const Benchmark& benchmark){
+    return selected.empty() || std::find(selected.begin(), selected.end(), benchmark.name) != selected.end();
+  };
+
+  try
+  {
+    for(const auto& benchmark : benchmarks)
+    {
+      if(!is_selected(benchmark))
+        continue;
+
+      std::cout << "#### " << benchmark.name << ": " << benchmark.description << std::endl;
+      benchmark.run();
+    }
+    return EXIT_SUCCESS;
+  }
+  catch(const std::exception& err){
+    std::cerr << "ERROR: " << err.what() << std::endl;
+  }
+  catch(...){
+    std::cerr << "ERROR: unknown exception" << std::endl;
+  }
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,299 @@
+#include <iostream>
+
+#include <libwyvern/wyvern.hpp>
+
+#include "bench.hpp"
+
+// Benchmarks of the complete extraction, which involves invoking CMake.
+// Like the basics test, these expect to be run from the root directory of the repository
+// to find the test cmake projects.
+
+namespace wyvern::bench {
+namespace {
+
+  const int iterations = 5;
+
+  const auto test_project_sources_dir = dir_path{ "libwyvern/tests/test_cmake_project/" };
+  const auto test_project_user_sources_dir = dir_path{ "libwyvern/tests/test_cmake_project_user/" };
+  const auto test_install_dir_name = dir_path{ "install-wyvern-test_cmake_project" };
+
+  auto build_install(const dir_path& source_dir, const dir_path& work_dir, const std::vector<cmake::Option>& cmake_options) -> void
+  {
+    const auto build_dir = (work_dir / dir_path("build-" + source_dir.leaf().string())).normalize(true, true);
+    const auto install_dir = (work_dir / test_install_dir_name).normalize(true, true);
+
+    auto args = std::vector<std::string>{ "-DCMAKE_INSTALL_PREFIX=" + install_dir.string(), "-DCMAKE_BUILD_TYPE=Release" };
+    for(const auto& option : cmake_options)
+    {
+      args.push_back("-D" + option.first + "=" + option.second);
+    }
+    args.insert(args.end(), { "-S", source_dir.string(), "-B", build_dir.string() });
+
+    cmake::invoke_cmake(args);
+    cmake::invoke_cmake({ "--build", build_dir.string(), "--config", "Release" });
+    cmake::invoke_cmake({ "--install", build_dir.string(), "--config", "Release" });
+  }
+
+  // Installs the test projects once for all the extraction benchmarks.
+  auto installed_test_projects() -> const cmake::Configuration&
+  {
+    static const scoped_temp_dir work_dir;
+    static const cmake::Configuration config = []{
+      const auto install_dir = (work_dir.path() / test_install_dir_name).normalize(true, true);
+
+      cmake::Configuration config;
+      config.packages = { { "test_cmake_project" }, { "test_cmake_project_user" } };
+      config.targets = { "test_project::aaa", "test_project::xxx", "test_project::yyy", "test_project::zzz", "test_project_user::user_aaa" };
+      config.options = { { "CMAKE_PREFIX_PATH", install_dir.string() } };
+
+      build_install(test_project_sources_dir, work_dir.path(), {});
+      build_install(test_project_user_sources_dir, work_dir.path(), config.options);
+      return config;
+    }();
+    return config;
+  }
+
+  auto concurrent_control_and_dependent() -> void
+  {
+    const auto& config = installed_test_projects();
+
+    Options sequential_options;
+    sequential_options.max_jobs = 1;
+    sequential_options.refresh_cache = true; // Otherwise the control project is only extracted once.
+    const auto sequential = measure("sequential extraction", iterations, [&]{
+      extract_dependencies(config, sequential_options);
+    });
+    report(sequential);
+
+    Options concurrent_options;
+    concurrent_options.max_jobs = 0;
+    concurrent_options.refresh_cache = true;
+    const auto concurrent = measure("concurrent extraction", iterations, [&]{
+      extract_dependencies(config, concurrent_options);
+    });
+    report(concurrent);
+
+    report_speedup(sequential, concurrent);
+  }
+
+  auto validation_modes() -> void
+  {
+    const auto& config = installed_test_projects();
+
+    const auto measure_validation = [&](std::string name, Validation validation){
+      Options options;
+      options.validation = validation;
+      options.refresh_cache = true; // The control project is also validated.
+      return measure(std::move(name), iterations, [&]{
+        extract_dependencies(config, options);
+      });
+    };
+
+    const auto link = measure_validation("validation: link", Validation::link);
+    report(link);
+    const auto compile = measure_validation("validation: compile", Validation::compile);
+    report(compile);
+    const auto none = measure_validation("validation: none", Validation::none);
+    report(none);
+
+    report_speedup(link, compile);
+    report_speedup(link, none);
+  }
+
+  auto work_directory_modes() -> void
+  {
+    const auto& config = installed_test_projects();
+
+    Options temporary_options;
+    temporary_options.validation = Validation::none; // Configuring is what changes.
+    temporary_options.refresh_cache = true;
+    const auto temporary = measure("temporary projects", iterations, [&]{
+      extract_dependencies(config, temporary_options);
+    });
+    report(temporary);
+
+    const scoped_temp_dir work_dir;
+    auto persistent_options = temporary_options;
+    persistent_options.work_directory = work_dir.path();
+    extract_dependencies(config, persistent_options); // Only the reconfigurations are measured.
+    const auto persistent = measure("persistent projects (reconfigured)", iterations, [&]{
+      extract_dependencies(config, persistent_options);
+    });
+    report(persistent);
+
+    report_speedup(temporary, persistent);
+  }
+
+  auto toolchain_detection_modes() -> void
+  {
+    const auto& config = installed_test_projects();
+
+    Options detecting_options;
+    detecting_options.validation = Validation::none; // Configuring is what changes.
+    detecting_options.refresh_cache = true;
+    detecting_options.reuse_toolchain_detection = false;
+    const auto detecting = measure("toolchain detected in each project", iterations, [&]{
+      extract_dependencies(config, detecting_options);
+    });
+    report(detecting);
+
+    auto reusing_options = detecting_options;
+    reusing_options.reuse_toolchain_detection = true;
+    extract_dependencies(config, reusing_options); // Only the reuses are measured.
+    const auto reusing = measure("toolchain detection reused", iterations, [&]{
+      extract_dependencies(config, reusing_options);
+    });
+    report(reusing);
+
+    report_speedup(detecting, reusing);
+  }
+
+  auto export_files_modes() -> void
+  {
+    const auto& config = installed_test_projects();
+
+    Options cmake_options;
+    cmake_options.validation = Validation::none; // Required to read the export files.
+    extract_dependencies(config, cmake_options); // The toolchain is detected once for both.
+    const auto with_cmake = measure("extracted with CMake", iterations, [&]{
+      extract_dependencies(config, cmake_options);
+    });
+    report(with_cmake);
+
+    auto reading_options = cmake_options;
+    reading_options.read_export_files = true;
+    const auto reading = measure("export files read", iterations, [&]{
+      extract_dependencies(config, reading_options);
+    });
+    report(reading);
+
+    report_speedup(with_cmake, reading);
+  }
+
+  auto backends() -> void
+  {
+    const auto& config = installed_test_projects();
+
+    Options diff_options;
+    diff_options.validation = Validation::none; // Configuring is what changes.
+    diff_options.refresh_cache = true; // Otherwise the control project is only extracted once.
+    extract_dependencies(config, diff_options); // The toolchain is detected once for both.
+    const auto diff = measure("control and dependent projects compared", iterations, [&]{
+      extract_dependencies(config, diff_options);
+    });
+    report(diff);
+
+    auto generated_options = diff_options;
+    generated_options.backend = Backend::generated_properties;
+    const auto generated = measure("usage requirements generated in one project", iterations, [&]{
+      extract_dependencies(config, generated_options);
+    });
+    report(generated);
+
+    auto traced_options = diff_options;
+    traced_options.backend = Backend::trace;
+    const auto traced = measure("imported targets reconstructed from CMake's trace", iterations, [&]{
+      extract_dependencies(config, traced_options);
+    });
+    report(traced);
+
+    report_speedup(diff, generated);
+    report_speedup(diff, traced);
+  }
+
+  auto configurations_modes() -> void
+  {
+    const auto& config = installed_test_projects();
+    const auto configurations = std::vector<std::string>{ "Debug", "Release" };
+
+    Options options;
+    options.validation = Validation::none; // Configuring is what changes.
+    options.refresh_cache = true;
+    extract_dependencies(config, options); // The toolchain is detected once for both.
+    const auto separate = measure("one extraction per configuration", iterations, [&]{
+      for(const auto& configuration : configurations)
+      {
+        auto single_config = config;
+        single_config.options.push_back({ "CMAKE_BUILD_TYPE", configuration });
+        extract_dependencies(single_config, options);
+      }
+    });
+    report(separate);
+
+    auto multi_config = config;
+    multi_config.configurations = configurations;
+    const auto together = measure("configurations extracted together", iterations, [&]{
+      extract_dependencies(multi_config, options);
+    });
+    report(together);
+
+    report_speedup(separate, together);
+  }
+
+  auto sharding_modes() -> void
+  {
+    auto config = installed_test_projects();
+    config.targets.push_back("wyvern_missing::target"); // Fails the extraction of all the targets it is extracted with.
+
+    Options options;
+    options.validation = Validation::none; // Configuring is what changes.
+    extract_dependencies_sharded(config, options); // The toolchain is detected once for all.
+
+    auto single_options = options;
+    single_options.shard_size = config.targets.size();
+    const auto single = measure("one shard, split when failing", iterations, [&]{
+      extract_dependencies_sharded(config, single_options);
+    });
+    report(single);
+
+    auto sharded_options = options;
+    sharded_options.shard_size = 2;
+    const auto sharded = measure("shards of 2 targets", iterations, [&]{
+      extract_dependencies_sharded(config, sharded_options);
+    });
+    report(sharded);
+
+    report_speedup(single, sharded);
+  }
+
+  auto extraction_allocations() -> void
+  {
+    const auto& config = installed_test_projects();
+
+    Options options;
+    options.validation = Validation::none; // Building happens in other processes, it would not change the counts.
+    options.refresh_cache = true;
+    extract_dependencies(config, options); // So that one-time initializations are not counted.
+
+    report(count_allocations("extract_dependencies", [&]{
+      extract_dependencies(config, options);
+    }));
+  }
+
+}
+
+  auto extraction_benchmarks() -> std::vector<Benchmark>
+  {
+    return {
+      { "extraction-concurrency", "latency of extract_dependencies with the control and dependent projects extracted sequentially or concurrently",
+        concurrent_control_and_dependent },
+      { "extraction-validation", "latency of extract_dependencies depending on how much of the generated projects is built",
+        validation_modes },
+      { "extraction-work-directory", "latency of extract_dependencies with temporary projects or persistent ones reconfigured incrementally",
+        work_directory_modes },
+      { "extraction-toolchain-detection", "latency of extract_dependencies with the toolchain detected in each generated project or once",
+        toolchain_detection_modes },
+      { "extraction-export-files", "latency of extract_dependencies running CMake on the generated projects or reading the packages' export files",
+        export_files_modes },
+      { "extraction-backends", "latency of extract_dependencies comparing a control project, generating the usage requirements or tracing the packages in a single project",
+        backends },
+      { "extraction-configurations", "latency of extract_dependencies for two configurations, extracted separately or together (one configure with Ninja Multi-Config)",
+        configurations_modes },
+      { "extraction-sharding", "latency of extract_dependencies_sharded isolating a failing target, depending on the size of the shards",
+        sharding_modes },
+      { "extraction-allocations", "allocations and peak memory used by extract_dependencies, CMake excluded",
+        extraction_allocations },
+    };
+  }
+
+}
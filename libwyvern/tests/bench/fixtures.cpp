@@ -0,0 +1,254 @@
+#include "fixtures.hpp"
+
+#include <map>
+#include <fstream>
+#include <utility>
+
+#include <nlohmann/json.hpp>
+#include <fmt/format.h>
+
+namespace wyvern::bench {
+namespace {
+
+  using json = nlohmann::json;
+  using fmt::format;
+
+  // What a generated target reply file contains.
+  struct TargetContent
+  {
+    std::string name;
+    std::vector<std::string> compile_fragments;
+    std::vector<std::string> defines;
+    std::vector<std::string> include_directories;
+    std::vector<std::pair<std::string, std::string>> link_fragments; // fragment and role
+    int sources = 1;
+    int backtrace_nodes = 100;
+  };
+
+  using Configurations = std::map<std::string, std::vector<TargetContent>>;
+
+  auto write_json(const dir_path& reply_dir, const std::string& filename, const json& content) -> std::size_t
+  {
+    const auto text = content.dump(2);
+    std::ofstream file{ (reply_dir / path(filename)).string() };
+    file << text;
+    return text.size();
+  }
+
+  auto target_reply(const TargetContent& target) -> json
+  {
+    json sources = json::array();
+    json source_indexes = json::array();
+    for(int source_idx = 0; source_idx < target.sources; ++source_idx)
+    {
+      sources.push_back({
+        { "backtrace", source_idx % target.backtrace_nodes },
+        { "compileGroupIndex", 0 },
+        { "path", format("src/{}/some/long/path/to/source_file_{}.cpp", target.name, source_idx) },
+        { "sourceGroupIndex", 0 },
+      });
+      source_indexes.push_back(source_idx);
+    }
+
+    json nodes = json::array();
+    for(int node_idx = 0; node_idx < target.backtrace_nodes; ++node_idx)
+    {
+      nodes.push_back({ { "command", node_idx % 7 }, { "file", node_idx % 13 }, { "line", 10 + node_idx }, { "parent", node_idx / 2 } });
+    }
+    json files = json::array();
+    for(int file_idx = 0; file_idx < 13; ++file_idx)
+      files.push_back(format("/usr/lib/cmake/some_package/some_package-targets-{}.cmake", file_idx));
+
+    json compile_fragments = json::array();
+    for(const auto& fragment : target.compile_fragments)
+      compile_fragments.push_back({ { "fragment", fragment } });
+
+    json defines = json::array();
+    for(std::size_t define_idx = 0; define_idx < target.defines.size(); ++define_idx)
+      defines.push_back({ { "backtrace", define_idx % target.backtrace_nodes }, { "define", target.defines[define_idx] } });
+
+    json includes = json::array();
+    for(std::size_t include_idx = 0; include_idx < target.include_directories.size(); ++include_idx)
+      includes.push_back({ { "backtrace", include_idx % target.backtrace_nodes }, { "isSystem", true }, { "path", target.include_directories[include_idx] } });
+
+    json link_fragments = json::array();
+    for(const auto& [fragment, role] : target.link_fragments)
+      link_fragments.push_back({ { "fragment", fragment }, { "role", role } });
+
+    return {
+      { "artifacts", json::array({ { { "path", target.name } } }) },
+      { "backtrace", 1 },
+      { "backtraceGraph", { { "commands", { "add_executable", "target_link_libraries", "add_library", "set_target_properties", "include", "find_package", "find_dependency" } }, { "files", files }, { "nodes", nodes } } },
+      { "compileGroups", json::array({ {
+        { "compileCommandFragments", compile_fragments },
+        { "defines", defines },
+        { "includes", includes },
+        { "language", "CXX" },
+        { "sourceIndexes", source_indexes },
+      } }) },
+      { "id", format("{}::@6890427a1f51a3e7e1df", target.name) },
+      { "link", { { "commandFragments", link_fragments }, { "language", "CXX" } } },
+      { "name", target.name },
+      { "nameOnDisk", target.name },
+      { "paths", { { "build", "." }, { "source", "." } } },
+      { "sourceGroups", json::array({ { { "name", "Source Files" }, { "sourceIndexes", source_indexes } } }) },
+      { "sources", sources },
+      { "type", "EXECUTABLE" },
+    };
+  }
+
+  auto write_reply_directory(const Configurations& configurations, const dir_path& reply_dir) -> std::size_t
+  {
+    std::size_t bytes_written = 0;
+
+    json codemodel_configurations = json::array();
+    for(const auto& [config_name, targets] : configurations)
+    {
+      json target_entries = json::array();
+      for(const auto& target : targets)
+      {
+        const auto filename = format("target-{}-{}-{:08x}.json", target.name, config_name, target_entries.size());
+        bytes_written += write_json(reply_dir, filename, target_reply(target));
+        target_entries.push_back({ { "name", target.name }, { "jsonFile", filename } });
+      }
+      codemodel_configurations.push_back({ { "name", config_name }, { "targets", target_entries } });
+    }
+
+    const json codemodel = {
+      { "kind", "codemodel" },
+      { "version", { { "major", 2 }, { "minor", 4 } } },
+      { "configurations", codemodel_configurations },
+    };
+    bytes_written += write_json(reply_dir, "codemodel-v2-0000.json", codemodel);
+
+    const json cmakefiles = {
+      { "kind", "cmakeFiles" },
+      { "version", { { "major", 1 }, { "minor", 0 } } },
+      { "inputs", json::array({
+        { { "path", "CMakeLists.txt" } },
+        { { "isExternal", true }, { "path", "/opt/packages/lib/cmake/some_package/some_package-config.cmake" } },
+        { { "isCMake", true }, { "isExternal", true }, { "path", "/usr/share/cmake/Modules/CMakeCXXInformation.cmake" } },
+      }) },
+    };
+    bytes_written += write_json(reply_dir, "cmakeFiles-v1-0000.json", cmakefiles);
+
+    const json index = {
+      { "reply", { { "client-wyvern", { { "query.json", { { "responses", json::array({
+        { { "kind", "codemodel" }, { "version", { { "major", 2 }, { "minor", 4 } } }, { "jsonFile", "codemodel-v2-0000.json" } },
+        { { "kind", "cmakeFiles" }, { "version", { { "major", 1 }, { "minor", 0 } } }, { "jsonFile", "cmakeFiles-v1-0000.json" } },
+      }) } } } } } } },
+    };
+    bytes_written += write_json(reply_dir, "index-0000-00-00T00-00-00-0000.json", index);
+
+    return bytes_written;
+  }
+
+  auto synthetic_target(const ReplyShape& shape, int target_idx) -> TargetContent
+  {
+    TargetContent target;
+    target.name = format("target_{}", target_idx);
+    target.sources = shape.sources_per_target;
+    target.backtrace_nodes = shape.backtrace_nodes;
+    for(int flag_idx = 0; flag_idx < shape.compile_flags; ++flag_idx)
+      target.compile_fragments.push_back(format("-fsome-flag-{} -Wsome-warning-{}", flag_idx, flag_idx));
+    for(int define_idx = 0; define_idx < shape.defines; ++define_idx)
+      target.defines.push_back(format("SOME_PACKAGE_DEFINE_{}=1", define_idx));
+    for(int include_idx = 0; include_idx < shape.include_directories; ++include_idx)
+      target.include_directories.push_back(format("/opt/packages/package_{}/include", include_idx));
+    target.link_fragments.push_back({ "-O3 -DNDEBUG", "flags" });
+    target.link_fragments.push_back({ "-Wl,-rpath,/opt/packages/lib", "libraries" });
+    for(int library_idx = 0; library_idx < shape.link_libraries; ++library_idx)
+      target.link_fragments.push_back({ format("/opt/packages/lib/libpackage_{}.so", library_idx), "libraries" });
+    return target;
+  }
+
+  // What the toolchain and the generated project add to every target, dependencies or not.
+  auto toolchain_target(std::string name, const PackageModel& package, const std::string& config_name) -> TargetContent
+  {
+    TargetContent target;
+    target.name = std::move(name);
+    target.compile_fragments = { config_name == "Debug" ? "-g" : "-O3 -DNDEBUG", "-std=gnu++17" };
+    for(int flag_idx = 0; flag_idx < package.compile_flags; ++flag_idx)
+      target.compile_fragments.push_back(format("-fsome-toolchain-flag-{}", flag_idx));
+    target.link_fragments.push_back({ config_name == "Debug" ? "-g" : "-O3 -DNDEBUG", "flags" });
+    return target;
+  }
+
+  auto component_target(const PackageModel& package, const std::string& component, const std::string& config_name) -> TargetContent
+  {
+    const auto prefix = format("/opt/{}", package.name);
+    auto target = toolchain_target(format("wyvern_{}_{}", package.name, component), package, config_name);
+    target.backtrace_nodes = package.backtrace_nodes;
+    target.compile_fragments.push_back("-pthread");
+
+    target.include_directories.push_back(format("{}/include", prefix));
+    for(int include_idx = 1; include_idx < package.include_directories; ++include_idx)
+      target.include_directories.push_back(format("{}/include/{}/private_{}", prefix, component, include_idx));
+
+    for(int define_idx = 0; define_idx < package.defines; ++define_idx)
+      target.defines.push_back(format("{}_{}_DEFINE_{}", package.name, component, define_idx));
+
+    // The component, then its transitive dependencies: the most used components of the package.
+    target.link_fragments.push_back({ format("-Wl,-rpath,{}/lib", prefix), "libraries" });
+    target.link_fragments.push_back({ format("{}/lib/lib{}_{}.so", prefix, package.name, component), "libraries" });
+    for(int library_idx = 1; library_idx < package.link_libraries; ++library_idx)
+    {
+      const auto& dependency = package.components[library_idx % package.components.size()];
+      target.link_fragments.push_back({ format("{}/lib/lib{}_{}.so", prefix, package.name, dependency), "libraries" });
+    }
+    target.link_fragments.push_back({ "-lpthread", "libraries" });
+    return target;
+  }
+
+}
+
+  auto generate_reply_directory(const ReplyShape& shape, const dir_path& reply_dir) -> std::size_t
+  {
+    std::vector<TargetContent> targets;
+    for(int target_idx = 0; target_idx < shape.targets; ++target_idx)
+      targets.push_back(synthetic_target(shape, target_idx));
+    return write_reply_directory({ { "Release", targets } }, reply_dir);
+  }
+
+  auto package_models() -> std::vector<PackageModel>
+  {
+    PackageModel fmt{ "fmt", { "fmt" } };
+    fmt.defines = 1; // FMT_SHARED
+    fmt.backtrace_nodes = 20;
+
+    PackageModel qt{ "qt5", { "core", "gui", "widgets", "network", "sql", "xml", "concurrent", "printsupport", "opengl", "test", "dbus", "svg" } };
+    qt.include_directories = 4; // include/, include/QtXxx/ and the ones of the modules it depends on
+    qt.defines = 3; // QT_XXX_LIB, QT_NO_DEBUG...
+    qt.compile_flags = 4;
+    qt.link_libraries = 4;
+    qt.backtrace_nodes = 600;
+    qt.configurations = { "Debug", "Release" };
+
+    PackageModel boost{ "boost", {} };
+    for(int component_idx = 0; component_idx < 150; ++component_idx)
+      boost.components.push_back(format("component_{}", component_idx));
+    boost.include_directories = 2;
+    boost.defines = 4; // BOOST_ALL_NO_LIB, BOOST_XXX_DYN_LINK...
+    boost.compile_flags = 8;
+    boost.link_libraries = 12;
+    boost.backtrace_nodes = 1500; // Chains of find_dependency() through the components' config files.
+    boost.configurations = { "Debug", "Release", "RelWithDebInfo", "MinSizeRel" };
+
+    return { fmt, qt, boost };
+  }
+
+  auto generate_extraction_replies(const PackageModel& package, const dir_path& control_reply_dir, const dir_path& dependent_reply_dir)
+    -> ExtractionReplies
+  {
+    Configurations control;
+    Configurations dependent;
+    for(const auto& config_name : package.configurations)
+    {
+      control[config_name].push_back(toolchain_target("wyvern_control", package, config_name));
+      for(const auto& component : package.components)
+        dependent[config_name].push_back(component_target(package, component, config_name));
+    }
+    return { write_reply_directory(control, control_reply_dir), write_reply_directory(dependent, dependent_reply_dir) };
+  }
+
+}
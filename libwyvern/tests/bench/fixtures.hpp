@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <libwyvern/wyvern.hpp>
+
+namespace wyvern::bench {
+
+  // Shape of a synthetic file-api reply directory.
+  struct ReplyShape
+  {
+    std::string name;
+    int targets = 1;
+    int sources_per_target = 10;
+    int compile_flags = 10;
+    int defines = 10;
+    int include_directories = 10;
+    int link_libraries = 10;
+    int backtrace_nodes = 100; // Size of the backtraceGraph, which we don't need.
+  };
+
+  // Writes index, codemodel, cmakeFiles and target reply files looking like what CMake
+  // generates for wyvern's query, into `reply_dir`. Returns the total size of the files written.
+  auto generate_reply_directory(const ReplyShape& shape, const dir_path& reply_dir) -> std::size_t;
+
+  // Package modeled on a real one, as wyvern extracts it: the dependent project has one
+  // executable target per requested component, the control project a single target.
+  struct PackageModel
+  {
+    std::string name;
+    std::vector<std::string> components;
+    int include_directories = 1; // Per component.
+    int defines = 1;
+    int compile_flags = 1; // In addition to the toolchain's, also used by the control target.
+    int link_libraries = 1; // Including transitive ones.
+    int backtrace_nodes = 100;
+    std::vector<std::string> configurations = { "Release" };
+  };
+
+  // Small (fmt), medium (Qt) and huge (Boost) packages.
+  auto package_models() -> std::vector<PackageModel>;
+
+  struct ExtractionReplies
+  {
+    std::size_t control_bytes = 0;
+    std::size_t dependent_bytes = 0;
+  };
+
+  // Writes the replies of the control and dependent projects generated for the package.
+  auto generate_extraction_replies(const PackageModel& package, const dir_path& control_reply_dir, const dir_path& dependent_reply_dir)
+    -> ExtractionReplies;
+
+}
@@ -0,0 +1,118 @@
+#include <sstream>
+#include <ostream>
+
+#include <libwyvern/wyvern.hpp>
+#include <libwyvern/utility.hpp>
+
+#include "bench.hpp"
+
+// Benchmarks of logging, which happens for each CMake invocation, file written and value read.
+
+namespace wyvern::bench {
+namespace {
+
+  const int iterations = 10;
+  const int message_count = 100000;
+
+  // Stands for the standard output, without the cost of the terminal.
+  struct NullBuffer : std::streambuf
+  {
+    auto overflow(int character) -> int override { return character; }
+  };
+  NullBuffer null_buffer;
+  std::ostream null_output{ &null_buffer };
+
+  // How messages were logged before: a stream per message, written and flushed synchronously.
+  bool stream_logging_enabled = false;
+
+  struct StreamLogger
+  {
+    std::stringstream logged;
+
+    StreamLogger()
+    {
+      if(stream_logging_enabled)
+        logged << "wyvern: ";
+    }
+
+    template<class Arg>
+    friend auto operator<<(StreamLogger&& logger, Arg&& to_log) -> StreamLogger&&
+    {
+      if(stream_logging_enabled)
+        logger.logged << std::forward<Arg>(to_log);
+      return std::move(logger);
+    }
+
+    ~StreamLogger()
+    {
+      if(stream_logging_enabled)
+        null_output << logged.str() << std::endl;
+    }
+  };
+
+  auto log_with_streams(int index) -> void
+  {
+    StreamLogger{} << fmt::format("writing into file /tmp/wyvern-1234-0/main_target_{}.cpp ({} bytes)", index, index * 7);
+  }
+
+  auto log_with_queue(int index) -> void
+  {
+    detail::log(LogLevel::debug, "writing into file /tmp/wyvern-1234-0/main_target_{}.cpp ({} bytes)", index, index * 7);
+  }
+
+  auto compare_loggers(bool is_enabled) -> void
+  {
+    stream_logging_enabled = is_enabled;
+    const auto was_enabled = enable_logging(is_enabled);
+    const auto previous_level = set_log_level(LogLevel::debug);
+    set_log_sink([](LogLevel, std::string_view message){
+      null_output << "wyvern: " << message << '\n';
+    });
+
+    const auto state = is_enabled ? "enabled" : "disabled";
+    const auto streams = measure(fmt::format("streams, {}, {} messages", state, message_count), iterations, [&]{
+      for(int index = 0; index < message_count; ++index)
+        log_with_streams(index);
+    });
+    report(streams);
+
+    const auto queue = measure(fmt::format("lazy + queue, {}, {} messages", state, message_count), iterations, [&]{
+      for(int index = 0; index < message_count; ++index)
+        log_with_queue(index);
+      flush_log(); // Includes the delivery in the measure.
+    });
+    report(queue);
+    report_speedup(streams, queue);
+
+    report(count_allocations(fmt::format("streams, {}", state), []{
+      for(int index = 0; index < 1000; ++index)
+        log_with_streams(index);
+    }));
+    report(count_allocations(fmt::format("lazy + queue, {}", state), []{
+      for(int index = 0; index < 1000; ++index)
+        log_with_queue(index);
+      flush_log();
+    }));
+
+    set_log_sink({});
+    set_log_level(previous_level);
+    enable_logging(was_enabled);
+  }
+
+  auto logging_overhead() -> void
+  {
+    compare_loggers(false);
+    compare_loggers(true);
+  }
+
+}
+
+  auto logging_benchmarks() -> std::vector<Benchmark>
+  {
+    return {
+      { "logging-overhead", "cost of logging, disabled and enabled: a stream per message written synchronously vs formatted only when enabled and queued",
+        logging_overhead },
+    };
+  }
+
+}
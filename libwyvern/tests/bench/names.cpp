@@ -0,0 +1,104 @@
+#include <regex>
+#include <algorithm>
+
+#include <libwyvern/utility.hpp>
+
+#include "bench.hpp"
+
+// Benchmarks of the processing of target names and injected code, done for each target of each extraction.
+
+namespace wyvern::bench {
+namespace {
+
+  const int iterations = 20;
+  const int target_count = 5000;
+
+  // How names were normalized and braces escaped before, with regular expressions.
+
+  auto regex_normalize_name(std::string name) -> std::string
+  {
+    std::transform(name.begin(), name.end(), name.begin(), [](auto c){ return std::tolower(c); });
+    static const std::regex to_replace(R"regex([\s | - | \. | \: | \( | \) )]+)regex");
+    return std::regex_replace(name, to_replace, "_");
+  }
+
+  auto regex_escape_braces(std::string text) -> std::string
+  {
+    static const auto left_brace_regex = std::regex("[{]");
+    static const auto right_brace_regex = std::regex("[}]");
+    text = std::regex_replace(text, left_brace_regex, "{{");
+    text = std::regex_replace(text, right_brace_regex, "}}");
+    return text;
+  }
+
+  auto generate_target_names()
+  {
+    std::vector<std::string> names;
+    for(int index = 0; index < target_count; ++index)
+      names.push_back(fmt::format("Some.Package-{}::Component (Part.{}) |x|  lib", index % 50, index));
+    return names;
+  }
+
+  auto names_normalization() -> void
+  {
+    const auto names = generate_target_names();
+    for(const auto& name : names)
+    {
+      if(regex_normalize_name(name) != detail::normalize_name(name))
+        throw std::runtime_error(fmt::format("different normalization of \"{}\"", name));
+    }
+
+    const auto regex = measure(fmt::format("regex, {} names", names.size()), iterations, [&]{
+      for(const auto& name : names)
+        regex_normalize_name(name);
+    });
+    report(regex);
+
+    const auto scanner = measure(fmt::format("single pass, {} names", names.size()), iterations, [&]{
+      for(const auto& name : names)
+        detail::normalize_name(name);
+    });
+    report(scanner);
+
+    report_speedup(regex, scanner);
+  }
+
+  auto braces_escaping() -> void
+  {
+    // Client code injected in each generated source, once formatted with the target name.
+    const std::string code = R"cpp(
+      #include <some/package/header.hpp>
+      namespace { struct Check { Check() { some::package::function({ 1, 2, 3 }); } } check; }
+      template<class T> auto use(T value) { return [value]{ return value; }(); }
+    )cpp";
+    if(regex_escape_braces(code) != detail::escape_braces(code))
+      throw std::runtime_error("different escaping of braces");
+
+    const auto regex = measure(fmt::format("regex, {} targets", target_count), iterations, [&]{
+      for(int index = 0; index < target_count; ++index)
+        regex_escape_braces(code);
+    });
+    report(regex);
+
+    const auto scanner = measure(fmt::format("single pass, {} targets", target_count), iterations, [&]{
+      for(int index = 0; index < target_count; ++index)
+        detail::escape_braces(code);
+    });
+    report(scanner);
+
+    report_speedup(regex, scanner);
+  }
+
+}
+
+  auto names_benchmarks() -> std::vector<Benchmark>
+  {
+    return {
+      { "names-normalization", "normalization of target names, with a regex or a single pass",
+        names_normalization },
+      { "braces-escaping", "escaping of the braces of the injected client code, with regexes or a single pass",
+        braces_escaping },
+    };
+  }
+
+}
@@ -0,0 +1,87 @@
+#include <sstream>
+#include <iostream>
+
+#include <libwyvern/wyvern.hpp>
+#include <libwyvern/file-api.hpp>
+#include <libwyvern/session.hpp>
+#include <libwyvern/diff.hpp>
+
+#include "bench.hpp"
+#include "fixtures.hpp"
+
+// Benchmarks of each step following CMake's invocations, on replies generated for packages
+// modeled on real ones: no CMake needed, only the CPU and memory costs of the library are measured.
+
+namespace wyvern::bench {
+namespace {
+
+  const int iterations = 10;
+
+  auto to_megabytes(std::size_t bytes) { return bytes / (1024.0 * 1024.0); }
+
+  auto package_pipeline(const PackageModel& package) -> void
+  {
+    const scoped_temp_dir control_work_dir;
+    const scoped_temp_dir dependent_work_dir;
+    const auto& control_reply_dir = control_work_dir.path();
+    const auto& dependent_reply_dir = dependent_work_dir.path();
+    const auto replies = generate_extraction_replies(package, control_reply_dir, dependent_reply_dir);
+    std::cout << fmt::format(" {}: {} components, {} configurations, {:.2f} MB of replies",
+      package.name, package.components.size(), package.configurations.size(), to_megabytes(replies.control_bytes + replies.dependent_bytes))
+      << std::endl;
+
+    // The state of the extraction at each step, as in extract_dependencies().
+    detail::ExtractionSession session;
+    const auto control_codemodel = cmake::read_cmake_api_reply_json(control_reply_dir, session.symbols);
+    const auto control = detail::extract_dependencies(control_codemodel, session.symbols);
+    const auto dependent_codemodel = cmake::read_cmake_api_reply_json(dependent_reply_dir, session.symbols);
+    const auto dependencies = detail::compare_dependencies(control, dependent_codemodel, session);
+    std::ostringstream printed;
+    printed << dependencies;
+    const auto printed_bytes = printed.str().size();
+
+    const auto read = [&]{
+      detail::ExtractionSession reading_session;
+      cmake::read_cmake_api_reply_json(dependent_reply_dir, reading_session.symbols);
+    };
+    const auto extract = [&]{
+      detail::extract_dependencies(dependent_codemodel, session.symbols);
+    };
+    const auto compare = [&]{
+      detail::compare_dependencies(control, dependent_codemodel, session);
+    };
+    const auto print = [&]{
+      std::ostringstream out;
+      out << dependencies;
+    };
+
+    report(measure("read_cmake_api_reply_json", iterations, read), replies.dependent_bytes);
+    report(measure("extract_dependencies(CodeModel)", iterations, extract));
+    report(measure("compare_dependencies", iterations, compare));
+    report(measure("operator<<", iterations, print), printed_bytes);
+
+    report(count_allocations("read_cmake_api_reply_json", read));
+    report(count_allocations("extract_dependencies(CodeModel)", extract));
+    report(count_allocations("compare_dependencies", compare));
+    report(count_allocations("operator<<", print));
+
+    std::cout << fmt::format("  peak RSS so far: {:.1f} MB", to_megabytes(peak_rss_bytes())) << std::endl;
+  }
+
+  auto extraction_pipeline() -> void
+  {
+    for(const auto& package : package_models())
+      package_pipeline(package);
+  }
+
+}
+
+  auto pipeline_benchmarks() -> std::vector<Benchmark>
+  {
+    return {
+      { "extraction-pipeline", "steps following CMake's invocations, on replies generated for small (fmt), medium (Qt) and huge (Boost) packages",
+        extraction_pipeline },
+    };
+  }
+
+}
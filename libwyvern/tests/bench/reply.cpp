@@ -0,0 +1,155 @@
+#include <map>
+#include <thread>
+#include <iostream>
+
+#include <nlohmann/json.hpp>
+#include <libbutl/filesystem.mxx>
+#include <libbutl/fdstream.mxx>
+#include <libbutl/string-parser.mxx>
+
+#include <libwyvern/wyvern.hpp>
+#include <libwyvern/file-api.hpp>
+#include <libwyvern/session.hpp>
+
+#include "bench.hpp"
+#include "fixtures.hpp"
+
+// Benchmarks of the reading of CMake's file-api replies, using generated reply directories.
+
+namespace wyvern::bench {
+namespace {
+
+  using json = nlohmann::json;
+
+  const int iterations = 5;
+
+  auto read_json(const path& file_path) -> json
+  {
+    butl::ifdstream file{ file_path };
+    return json::parse(file.read_text());
+  }
+
+  auto append_parsed(std::vector<std::string>& values, const std::string& fragment) -> void
+  {
+    const auto parsed = butl::string_parser::parse_quoted(fragment, true);
+    values.insert(values.end(), parsed.begin(), parsed.end());
+  }
+
+  // How the replies were read before being streamed: each target file is loaded as a json document,
+  // all of them being kept alive until the information is extracted.
+  auto read_reply_with_documents(const dir_path& reply_dir) -> DependenciesInfo
+  {
+    path index_path;
+    butl::path_search(path("index-*.json"), [&](path found, const std::string&, bool){
+      index_path = reply_dir / found;
+      return false;
+    }, reply_dir);
+
+    const auto index = read_json(index_path);
+    const auto& responses = index["reply"]["client-wyvern"]["query.json"]["responses"];
+    const auto codemodel = read_json(reply_dir / path(responses[0]["jsonFile"].get<std::string>()));
+
+    std::map<std::string, std::map<std::string, json>> target_documents;
+    for(const auto& config : codemodel["configurations"])
+    {
+      for(const auto& target : config["targets"])
+      {
+        target_documents[config["name"]][target["name"]] = read_json(reply_dir / path(target["jsonFile"].get<std::string>()));
+      }
+    }
+
+    DependenciesInfo result;
+    for(const auto& [config_name, targets] : target_documents)
+    {
+      for(const auto& [target_name, target_json] : targets)
+      {
+        Target target;
+        target.name = target_json["name"];
+        for(const auto& compile_group : target_json["compileGroups"])
+        {
+          auto& compilation = target.language_compilation[compile_group["language"]];
+          for(const auto& fragment : compile_group["compileCommandFragments"])
+            append_parsed(compilation.compilation_flags, fragment["fragment"]);
+          for(const auto& define : compile_group["defines"])
+            compilation.defines.push_back(define["define"]);
+          for(const auto& include : compile_group["includes"])
+            compilation.include_directories.push_back(include["path"]);
+        }
+        for(const auto& fragment : target_json["link"]["commandFragments"])
+        {
+          append_parsed(fragment["role"] == "flags" ? target.link_flags : target.link_libraries, fragment["fragment"]);
+        }
+        result.configurations[config_name].targets[target_name] = std::move(target);
+      }
+    }
+    return result;
+  }
+
+  auto compare_readers(const ReplyShape& shape) -> void
+  {
+    const scoped_temp_dir reply_dir;
+    const auto bytes = generate_reply_directory(shape, reply_dir.path());
+    std::cout << fmt::format(" {}: {} targets, {:.1f} MB of replies", shape.name, shape.targets, bytes / (1024.0 * 1024.0)) << std::endl;
+
+    const auto documents = measure("json documents", iterations, [&]{
+      read_reply_with_documents(reply_dir.path());
+    });
+    report(documents, bytes);
+
+    const auto streamed = measure("streamed, 1 thread", iterations, [&]{
+      detail::ExtractionSession session;
+      cmake::read_cmake_api_reply_json(reply_dir.path(), session.symbols, 1);
+    });
+    report(streamed, bytes);
+
+    const auto threads = std::thread::hardware_concurrency();
+    const auto concurrent = measure(fmt::format("streamed, {} threads", threads), iterations, [&]{
+      detail::ExtractionSession session;
+      cmake::read_cmake_api_reply_json(reply_dir.path(), session.symbols, threads);
+    });
+    report(concurrent, bytes);
+
+    report_speedup(documents, streamed);
+    report_speedup(streamed, concurrent);
+  }
+
+  auto compare_allocations(const ReplyShape& shape) -> void
+  {
+    const scoped_temp_dir reply_dir;
+    const auto bytes = generate_reply_directory(shape, reply_dir.path());
+    std::cout << fmt::format(" {}: {} targets, {:.1f} MB of replies", shape.name, shape.targets, bytes / (1024.0 * 1024.0)) << std::endl;
+
+    report(count_allocations("json documents", [&]{
+      read_reply_with_documents(reply_dir.path());
+    }));
+    report(count_allocations("streamed, 1 thread", [&]{
+      detail::ExtractionSession session;
+      cmake::read_cmake_api_reply_json(reply_dir.path(), session.symbols, 1);
+    }));
+  }
+
+  auto reply_allocations() -> void
+  {
+    compare_allocations({ "small", 20, 10, 10, 10, 10, 10, 100 });
+    compare_allocations({ "large", 200, 2000, 50, 50, 50, 50, 5000 });
+  }
+
+  auto reply_reading() -> void
+  {
+    compare_readers({ "small", 20, 10, 10, 10, 10, 10, 100 });
+    compare_readers({ "large", 200, 2000, 50, 50, 50, 50, 5000 });
+  }
+
+}
+
+  auto reply_benchmarks() -> std::vector<Benchmark>
+  {
+    return {
+      { "reply-reading", "reading of file-api replies, loaded as json documents or streamed with 1 or more threads",
+        reply_reading },
+      { "reply-allocations", "allocations and peak memory used while reading file-api replies",
+        reply_allocations },
+    };
+  }
+
+}
@@ -1,36 +1,114 @@
 #include <iostream>
+#include <string_view>
+#include <charconv>
+#include <system_error>
 
 #include <libwyvern/wyvern.hpp>
 
+// usage: wyvern [<option>...] <cmake-install-dir> <package> <target>...
+//
+// options:
+//   --cache-dir <dir>  Cache extraction results in <dir> and reuse them when nothing changed.
+//   --refresh-cache    Ignore cached results, extract again and update the cache.
+//   --clear-cache      Remove all the cached results from the cache directory before extracting.
+//   --work-dir <dir>   Keep the generated projects in <dir>, to reconfigure them incrementally in the next runs.
+//   --config <name>    Extract the configuration <name> (Debug, Release...), can be repeated. All of them
+//                      come from one configure when the generator supports several configurations.
+//   --shard-size <n>   Extract the targets <n> at a time, in parallel, isolating the ones which fail: the others
+//                      are still reported, the failures are listed after them.
+//   --trace <file>     Write the timing of the extraction's phases to <file> (Chrome trace-event JSON,
+//                      open it in chrome://tracing or https://ui.perfetto.dev).
 
 int main (int argc, char* argv[])
 {
-  if(argc < 3)
+  wyvern::Options options;
+  options.enable_logging = true;
+  options.keep_generated_projects = true;
+  bool clear_cache = false;
+  std::vector<std::string> configurations;
+  bool is_sharded = false;
+
+  std::vector<std::string_view> args;
+  for(int arg_idx = 1; arg_idx < argc; ++arg_idx)
+  {
+    const std::string_view arg = argv[arg_idx];
+    if(arg == "--cache-dir" && arg_idx + 1 < argc)
+      options.cache_directory = wyvern::dir_path(argv[++arg_idx]).complete();
+    else if(arg == "--refresh-cache")
+      options.refresh_cache = true;
+    else if(arg == "--clear-cache")
+      clear_cache = true;
+    else if(arg == "--work-dir" && arg_idx + 1 < argc)
+      options.work_directory = wyvern::dir_path(argv[++arg_idx]).complete();
+    else if(arg == "--config" && arg_idx + 1 < argc)
+      configurations.push_back(argv[++arg_idx]);
+    else if(arg == "--shard-size" && arg_idx + 1 < argc)
+    {
+      const std::string_view value = argv[++arg_idx];
+      const auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), options.shard_size);
+      if(error != std::errc{} || end != value.data() + value.size() || options.shard_size == 0)
+      {
+        std::cerr << "FAIL! invalid shard size (expected a number of targets, at least 1): " << value << std::endl;
+        return EXIT_FAILURE;
+      }
+      is_sharded = true;
+    }
+    else if(arg == "--trace" && arg_idx + 1 < argc)
+      options.trace_file = wyvern::path(argv[++arg_idx]).complete();
+    else if(arg.substr(0, 2) == "--")
+    {
+      std::cerr << "FAIL! unknown or incomplete option: " << arg << std::endl;
+      return EXIT_FAILURE;
+    }
+    else
+      args.push_back(arg);
+  }
+
+  if(args.size() < 2)
   {
     std::cerr << "FAIL!" << std::endl;
     return EXIT_FAILURE;
   }
 
-  const auto cmake_install_dir = wyvern::dir_path(argv[1]).realize();
+  if(clear_cache && !options.cache_directory.empty())
+    wyvern::clear_cache(options.cache_directory);
+
+  const auto cmake_install_dir = wyvern::dir_path(std::string(args[0])).realize();
 
   wyvern::cmake::Configuration config;
-  config.args = { "--config release" };
+  if(configurations.empty())
+    config.args = { "--config release" };
+  config.configurations = configurations;
   config.options = {
     { "CMAKE_PREFIX_PATH", cmake_install_dir.string() }
   };
 
-  config.packages = { { argv[2], /*"1.73.0", { "COMPONENTS filesystem" }*/ } };
+  config.packages = { { std::string(args[1]), /*"1.73.0", { "COMPONENTS filesystem" }*/ } };
 
-  for(int target_name_idx = 3; target_name_idx < argc; ++target_name_idx)
+  for(std::size_t target_name_idx = 2; target_name_idx < args.size(); ++target_name_idx)
   {
-    config.targets.push_back(argv[target_name_idx]);
+    config.targets.push_back(std::string(args[target_name_idx]));
   }
 
-  wyvern::Options options;
-  options.enable_logging = true;
-  options.keep_generated_projects = true;
+  if(!is_sharded)
+  {
+    const auto deps_info = extract_dependencies(config, options);
+    std::cout << "############# WYVERN: DEDUCED DEPENDENCIES ##############" << std::endl;
+    std::cout << deps_info << std::endl;
+    return EXIT_SUCCESS;
+  }
 
-  const auto deps_info = extract_dependencies(config, options);
+  const auto result = extract_dependencies_sharded(config, options);
   std::cout << "############# WYVERN: DEDUCED DEPENDENCIES ##############" << std::endl;
-  std::cout << deps_info << std::endl;
+  std::cout << result.dependencies << std::endl;
+
+  bool is_failed = false;
+  for(const auto& [target_name, status] : result.targets)
+  {
+    if(status.is_extracted)
+      continue;
+    std::cerr << "FAILED: " << target_name << ": " << status.error << std::endl;
+    is_failed = true;
+  }
+  return is_failed ? EXIT_FAILURE : EXIT_SUCCESS;
 }